@@ -0,0 +1,88 @@
+//! `process_raw` cost as the channel count grows towards
+//! `AUTOMIX_MAX_CHANNELS`, on one thread and split across a worker pool.
+//!
+//! Throughput is reported per channel-sample, so linear scaling shows up as
+//! a flat rate across the group.
+
+mod common;
+
+use automix_dsp::{AutomixConfig, AutomixEngine, AUTOMIX_MAX_CHANNELS};
+use criterion::measurement::WallTime;
+use criterion::{
+    criterion_group, criterion_main, BenchmarkGroup, BenchmarkId, Criterion, Throughput,
+};
+use std::time::{Duration, Instant};
+
+const SAMPLE_RATE: f32 = 48_000.0;
+
+/// Noise with one talker-level channel in eight.
+fn source_block(channels: usize, block_size: usize) -> Vec<Vec<f32>> {
+    common::noise_bursts(
+        channels,
+        block_size,
+        |_, c| if c % 8 == 0 { 0.3 } else { 0.003 },
+    )
+}
+
+/// Time `process_raw` alone, restoring the input before every block.
+fn bench_engine(group: &mut BenchmarkGroup<'_, WallTime>, id: BenchmarkId, config: AutomixConfig) {
+    let channels = config.num_channels as usize;
+    let block_size = config.max_block_size as usize;
+    let source = source_block(channels, block_size);
+    let mut buffers = source.clone();
+    let ptrs = common::channel_ptrs(&mut buffers);
+    let mut engine = AutomixEngine::with_config(&config);
+
+    group.throughput(Throughput::Elements((channels * block_size) as u64));
+    group.bench_function(id, |b| {
+        b.iter_custom(|iters| {
+            let mut total = Duration::ZERO;
+            for _ in 0..iters {
+                for (buffer, src) in buffers.iter_mut().zip(&source) {
+                    buffer.copy_from_slice(src);
+                }
+                let start = Instant::now();
+                unsafe { engine.process_raw(ptrs.as_ptr(), channels, block_size) };
+                total += start.elapsed();
+            }
+            total
+        })
+    });
+}
+
+fn bench_channel_scaling(c: &mut Criterion) {
+    let mut group = c.benchmark_group("channel_scaling");
+    let mut channels = 16;
+    while channels <= AUTOMIX_MAX_CHANNELS {
+        bench_engine(
+            &mut group,
+            BenchmarkId::from_parameter(channels),
+            AutomixConfig::new(channels, SAMPLE_RATE, 256),
+        );
+        channels *= 2;
+    }
+    group.finish();
+}
+
+/// 64-sample blocks, the tightest deadline the pool is meant for. Workers
+/// spin between blocks so wake-up latency is not part of the measurement.
+fn bench_worker_pool(c: &mut Criterion) {
+    let mut group = c.benchmark_group("worker_pool");
+    for channels in [64, 128, 256] {
+        for workers in [0, 1, 3] {
+            bench_engine(
+                &mut group,
+                BenchmarkId::new(format!("{}_threads", workers + 1), channels),
+                AutomixConfig {
+                    num_workers: workers,
+                    worker_spin_us: 10_000,
+                    ..AutomixConfig::new(channels, SAMPLE_RATE, 64)
+                },
+            );
+        }
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_channel_scaling, bench_worker_pool);
+criterion_main!(benches);
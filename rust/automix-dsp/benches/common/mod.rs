@@ -0,0 +1,44 @@
+//! Material and buffer setup shared by the benches.
+//!
+//! Each bench includes this with `mod common;` and uses only part of it.
+
+#![allow(dead_code)]
+
+/// Deterministic xorshift noise in -1..1, `level(s, c)` scaling sample `s`
+/// of channel `c`. Samples are drawn frame by frame, so the same channel
+/// count gives the same material whatever the length.
+pub fn noise_bursts(
+    channels: usize,
+    len: usize,
+    mut level: impl FnMut(usize, usize) -> f32,
+) -> Vec<Vec<f32>> {
+    let mut state = 0x2545_f491u32;
+    let mut buffers = vec![vec![0.0f32; len]; channels];
+    for s in 0..len {
+        for (c, buffer) in buffers.iter_mut().enumerate() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            let noise = state as f32 / u32::MAX as f32 * 2.0 - 1.0;
+            buffer[s] = noise * level(s, c);
+        }
+    }
+    buffers
+}
+
+/// One talker at a time in noise bursts over a quiet floor on every other
+/// channel, changing every 2.5 ms at 48 kHz so the gains keep moving.
+pub fn talker_in_noise(channels: usize, len: usize) -> Vec<Vec<f32>> {
+    noise_bursts(channels, len, |s, c| {
+        if c == s / 120 % channels {
+            0.3
+        } else {
+            0.002
+        }
+    })
+}
+
+/// Channel pointers into `buffers` for `process_raw` and the FFI calls.
+pub fn channel_ptrs(buffers: &mut [Vec<f32>]) -> Vec<*mut f32> {
+    buffers.iter_mut().map(|b| b.as_mut_ptr()).collect()
+}
@@ -0,0 +1,155 @@
+//! Cost of control-rate gain sharing against the artifacts it introduces.
+//!
+//! Every configuration runs the same speech-like material through a
+//! per-sample engine and through engines that update every 16 and 32
+//! samples. Next to the time per sample and channel, the summary reports
+//! the control-rate output's deviation from the per-sample output: the
+//! error-to-signal ratio over the whole render, and the largest gain
+//! difference seen at any block end.
+
+mod common;
+
+use automix_dsp::{AutomixConfig, AutomixEngine};
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use std::time::{Duration, Instant};
+
+const CHANNELS: usize = 32;
+const BLOCK_SIZE: usize = 512;
+const SAMPLE_RATES: [f32; 3] = [48_000.0, 96_000.0, 192_000.0];
+const INTERVALS: [u32; 3] = [1, 16, 32];
+
+/// Length of the material compared for artifacts.
+const RENDER_SECONDS: f32 = 2.0;
+
+/// One talker at a time in noise bursts shaped by a 4 Hz syllable envelope,
+/// over a quiet floor on every other channel. The talker changes every
+/// 250 ms so the share keeps moving.
+fn speech(sample_rate: f32, len: usize) -> Vec<Vec<f32>> {
+    common::noise_bursts(CHANNELS, len, |s, c| {
+        let t = s as f32 / sample_rate;
+        if c == (t * 4.0) as usize % CHANNELS {
+            0.3 * (0.5 + 0.5 * (std::f32::consts::TAU * 4.0 * t).sin())
+        } else {
+            0.002
+        }
+    })
+}
+
+fn engine(sample_rate: f32, interval: u32) -> AutomixEngine {
+    AutomixEngine::with_config(&AutomixConfig {
+        control_interval: interval,
+        ..AutomixConfig::new(CHANNELS, sample_rate, BLOCK_SIZE)
+    })
+}
+
+/// Process `buffers` in place, block by block, returning the gains at the
+/// end of every block.
+fn render(engine: &mut AutomixEngine, buffers: &mut [Vec<f32>]) -> Vec<f32> {
+    let len = buffers[0].len();
+    let mut gains = Vec::new();
+    let mut offset = 0;
+    while offset + BLOCK_SIZE <= len {
+        let ptrs: Vec<*mut f32> = buffers
+            .iter_mut()
+            .map(|b| b[offset..].as_mut_ptr())
+            .collect();
+        unsafe { engine.process_raw(ptrs.as_ptr(), CHANNELS, BLOCK_SIZE) };
+        gains.extend_from_slice(engine.gains());
+        offset += BLOCK_SIZE;
+    }
+    gains
+}
+
+struct Artifacts {
+    error_db: f64,
+    max_gain_diff: f32,
+}
+
+fn artifacts(sample_rate: f32, interval: u32) -> Artifacts {
+    let input = speech(sample_rate, (RENDER_SECONDS * sample_rate) as usize);
+    let mut reference = input.clone();
+    let mut decimated = input;
+    let reference_gains = render(&mut engine(sample_rate, 1), &mut reference);
+    let decimated_gains = render(&mut engine(sample_rate, interval), &mut decimated);
+
+    let (mut signal, mut error) = (0.0f64, 0.0f64);
+    for (r, d) in reference.iter().flatten().zip(decimated.iter().flatten()) {
+        signal += (*r as f64).powi(2);
+        error += (*d as f64 - *r as f64).powi(2);
+    }
+    Artifacts {
+        error_db: 10.0 * (error.max(1e-30) / signal).log10(),
+        max_gain_diff: reference_gains
+            .iter()
+            .zip(&decimated_gains)
+            .map(|(r, d)| (r - d).abs())
+            .fold(0.0, f32::max),
+    }
+}
+
+fn bench_control_rate(c: &mut Criterion) {
+    let mut rows = Vec::new();
+    let mut group = c.benchmark_group("control_rate");
+    group
+        .warm_up_time(Duration::from_millis(500))
+        .measurement_time(Duration::from_secs(2))
+        .throughput(Throughput::Elements((CHANNELS * BLOCK_SIZE) as u64));
+
+    for &sample_rate in &SAMPLE_RATES {
+        let source = speech(sample_rate, BLOCK_SIZE);
+        for &interval in &INTERVALS {
+            let mut engine = engine(sample_rate, interval);
+            let mut buffers = source.clone();
+            let ptrs = common::channel_ptrs(&mut buffers);
+            let (mut total, mut blocks) = (Duration::ZERO, 0u64);
+
+            group.bench_function(
+                BenchmarkId::new(format!("{sample_rate}Hz"), interval),
+                |b| {
+                    b.iter_custom(|iters| {
+                        let mut elapsed = Duration::ZERO;
+                        for _ in 0..iters {
+                            for (buffer, src) in buffers.iter_mut().zip(&source) {
+                                buffer.copy_from_slice(src);
+                            }
+                            let start = Instant::now();
+                            unsafe { engine.process_raw(ptrs.as_ptr(), CHANNELS, BLOCK_SIZE) };
+                            elapsed += start.elapsed();
+                        }
+                        total += elapsed;
+                        blocks += iters;
+                        elapsed
+                    })
+                },
+            );
+
+            let ns =
+                total.as_nanos() as f64 / (blocks.max(1) * (CHANNELS * BLOCK_SIZE) as u64) as f64;
+            rows.push((sample_rate, interval, ns, artifacts(sample_rate, interval)));
+        }
+    }
+    group.finish();
+
+    println!(
+        "\n{:>8} {:>8} {:>10} {:>8} {:>10} {:>10}",
+        "rate", "interval", "ns/smp/ch", "speedup", "error dB", "max dgain"
+    );
+    for &(sample_rate, interval, ns, ref a) in &rows {
+        let per_sample = rows
+            .iter()
+            .find(|r| r.0 == sample_rate && r.1 == 1)
+            .map_or(ns, |r| r.2);
+        println!(
+            "{:>8} {:>8} {:>10.3} {:>7.2}x {:>10.1} {:>10.4}",
+            sample_rate,
+            interval,
+            ns,
+            per_sample / ns,
+            a.error_db,
+            a.max_gain_diff
+        );
+    }
+}
+
+criterion_group!(benches, bench_control_rate);
+criterion_main!(benches);
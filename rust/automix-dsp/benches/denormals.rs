@@ -0,0 +1,118 @@
+//! What flushing subnormals in `automix_process` saves on silent tails.
+//!
+//! Every engine first hears a burst on all channels and then long enough
+//! silence for its detector envelopes to decay into the subnormal range
+//! (where, unflushed, they get stuck). It is then timed on more silence and
+//! on speech-like material, once through `process_raw` in the default
+//! floating-point mode and once through `automix_process`, which flushes
+//! subnormals around the block. The summary reports the time per sample and
+//! channel of each and the slowdown the flush prevents.
+
+mod common;
+
+use automix_dsp::ffi::automix_process;
+use automix_dsp::AutomixEngine;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use std::time::{Duration, Instant};
+
+const CHANNELS: usize = 32;
+const BLOCK_SIZE: usize = 512;
+const SAMPLE_RATE: f32 = 48_000.0;
+
+/// Silence after the burst before timing starts; the envelopes take about
+/// six seconds to fall from the burst to where they stop moving.
+const TAIL_SECONDS: f32 = 8.0;
+
+/// One talker at a time in noise bursts over a quiet floor on every other
+/// channel; `level` 0 gives silence.
+fn material(level: f32, len: usize) -> Vec<Vec<f32>> {
+    common::noise_bursts(CHANNELS, len, |s, c| {
+        level * if c == s / 4800 % CHANNELS { 1.0 } else { 0.01 }
+    })
+}
+
+/// Process one block in place, flushing subnormals or not.
+fn process(engine: &mut AutomixEngine, ptrs: &[*mut f32], flush: bool) {
+    unsafe {
+        if flush {
+            automix_process(engine, ptrs.as_ptr(), CHANNELS as u32, BLOCK_SIZE as u32);
+        } else {
+            engine.process_raw(ptrs.as_ptr(), CHANNELS, BLOCK_SIZE);
+        }
+    }
+}
+
+/// An engine whose envelopes have decayed through a silent tail.
+fn after_tail(flush: bool) -> AutomixEngine {
+    let mut engine = AutomixEngine::new(CHANNELS, SAMPLE_RATE, BLOCK_SIZE);
+    let mut burst = vec![vec![0.5f32; BLOCK_SIZE]; CHANNELS];
+    process(&mut engine, &common::channel_ptrs(&mut burst), flush);
+    let mut silence = material(0.0, BLOCK_SIZE);
+    let ptrs = common::channel_ptrs(&mut silence);
+    for _ in 0..(TAIL_SECONDS * SAMPLE_RATE) as usize / BLOCK_SIZE {
+        process(&mut engine, &ptrs, flush);
+    }
+    engine
+}
+
+fn bench_denormals(c: &mut Criterion) {
+    let mut rows = Vec::new();
+    let mut group = c.benchmark_group("denormals");
+    group
+        .warm_up_time(Duration::from_millis(500))
+        .measurement_time(Duration::from_secs(2))
+        .throughput(Throughput::Elements((CHANNELS * BLOCK_SIZE) as u64));
+
+    for (name, level) in [("silence", 0.0), ("speech", 0.3)] {
+        let source = material(level, BLOCK_SIZE);
+        let mut ns = [0.0; 2];
+        for (flush, ns) in [false, true].into_iter().zip(&mut ns) {
+            let mut engine = after_tail(flush);
+            let mut buffers = source.clone();
+            let ptrs = common::channel_ptrs(&mut buffers);
+            let (mut total, mut blocks) = (Duration::ZERO, 0u64);
+
+            let mode = if flush {
+                "automix_process"
+            } else {
+                "process_raw"
+            };
+            group.bench_function(BenchmarkId::new(name, mode), |b| {
+                b.iter_custom(|iters| {
+                    let mut elapsed = Duration::ZERO;
+                    for _ in 0..iters {
+                        for (buffer, src) in buffers.iter_mut().zip(&source) {
+                            buffer.copy_from_slice(src);
+                        }
+                        let start = Instant::now();
+                        process(&mut engine, &ptrs, flush);
+                        elapsed += start.elapsed();
+                    }
+                    total += elapsed;
+                    blocks += iters;
+                    elapsed
+                })
+            });
+            *ns = total.as_nanos() as f64 / (blocks.max(1) * (CHANNELS * BLOCK_SIZE) as u64) as f64;
+        }
+        rows.push((name, ns));
+    }
+    group.finish();
+
+    println!(
+        "\n{:>8} {:>12} {:>15} {:>9}",
+        "input", "process_raw", "automix_process", "slowdown"
+    );
+    for &(name, [raw, flushed]) in &rows {
+        println!(
+            "{:>8} {:>12.3} {:>15.3} {:>8.2}x",
+            name,
+            raw,
+            flushed,
+            raw / flushed
+        );
+    }
+}
+
+criterion_group!(benches, bench_denormals);
+criterion_main!(benches);
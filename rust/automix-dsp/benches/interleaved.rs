@@ -0,0 +1,138 @@
+//! Interleaved I/O straight into the kernel against deinterleaving on the
+//! host side.
+//!
+//! For each channel count the same interleaved speech-like block is
+//! processed three ways: deinterleaved into planar buffers, run through
+//! `process_raw` and interleaved again, as a host had to before
+//! `automix_process_interleaved`; through `automix_process_interleaved` in
+//! place; and through it into planar output buffers. 32 channels fill two
+//! 16-channel groups, so their frames are read and written in place; 24
+//! channels go through a padded copy per frame.
+
+mod common;
+
+use automix_dsp::ffi::automix_process_interleaved;
+use automix_dsp::simd::AlignedBuf;
+use automix_dsp::AutomixEngine;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use std::ptr;
+use std::time::{Duration, Instant};
+
+const CHANNEL_COUNTS: [usize; 2] = [32, 24];
+const BLOCK_SIZE: usize = 512;
+const SAMPLE_RATE: f32 = 48_000.0;
+const PATHS: [&str; 3] = ["host_deinterleave", "interleaved", "to_planar"];
+
+/// `common::talker_in_noise` as interleaved frames.
+fn speech(channels: usize) -> AlignedBuf {
+    let planar = common::talker_in_noise(channels, BLOCK_SIZE);
+    let mut frames = AlignedBuf::zeroed(channels * BLOCK_SIZE);
+    for (c, buffer) in planar.iter().enumerate() {
+        for (s, &x) in buffer.iter().enumerate() {
+            frames[s * channels + c] = x;
+        }
+    }
+    frames
+}
+
+/// Process `frames` in place by way of planar buffers.
+unsafe fn host_deinterleave(
+    engine: &mut AutomixEngine,
+    frames: &mut [f32],
+    planar: &mut [Vec<f32>],
+    ptrs: &[*mut f32],
+) {
+    let channels = planar.len();
+    for (c, buffer) in planar.iter_mut().enumerate() {
+        for (s, x) in buffer.iter_mut().enumerate() {
+            *x = frames[s * channels + c];
+        }
+    }
+    engine.process_raw(ptrs.as_ptr(), channels, BLOCK_SIZE);
+    for (c, buffer) in planar.iter().enumerate() {
+        for (s, &x) in buffer.iter().enumerate() {
+            frames[s * channels + c] = x;
+        }
+    }
+}
+
+fn bench_interleaved(c: &mut Criterion) {
+    let mut rows = Vec::new();
+    let mut group = c.benchmark_group("interleaved");
+    group
+        .warm_up_time(Duration::from_millis(500))
+        .measurement_time(Duration::from_secs(2));
+
+    for &channels in &CHANNEL_COUNTS {
+        group.throughput(Throughput::Elements((channels * BLOCK_SIZE) as u64));
+        let source = speech(channels);
+        let mut ns = [0.0; PATHS.len()];
+        for (path, ns) in PATHS.iter().zip(&mut ns) {
+            let mut engine = AutomixEngine::new(channels, SAMPLE_RATE, BLOCK_SIZE);
+            let mut frames = AlignedBuf::zeroed(channels * BLOCK_SIZE);
+            let mut planar = vec![vec![0.0f32; BLOCK_SIZE]; channels];
+            let ptrs = common::channel_ptrs(&mut planar);
+            let (mut total, mut blocks) = (Duration::ZERO, 0u64);
+
+            group.bench_function(BenchmarkId::new(*path, channels), |b| {
+                b.iter_custom(|iters| {
+                    let mut elapsed = Duration::ZERO;
+                    for _ in 0..iters {
+                        frames.copy_from_slice(&source);
+                        let start = Instant::now();
+                        unsafe {
+                            let engine_ptr = &mut engine as *mut AutomixEngine;
+                            let input = frames.as_ptr();
+                            match *path {
+                                "host_deinterleave" => {
+                                    host_deinterleave(&mut engine, &mut frames, &mut planar, &ptrs)
+                                }
+                                "interleaved" => automix_process_interleaved(
+                                    engine_ptr,
+                                    input,
+                                    frames.as_mut_ptr(),
+                                    ptr::null(),
+                                    channels as u32,
+                                    BLOCK_SIZE as u32,
+                                ),
+                                _ => automix_process_interleaved(
+                                    engine_ptr,
+                                    input,
+                                    ptr::null_mut(),
+                                    ptrs.as_ptr(),
+                                    channels as u32,
+                                    BLOCK_SIZE as u32,
+                                ),
+                            }
+                        }
+                        elapsed += start.elapsed();
+                    }
+                    total += elapsed;
+                    blocks += iters;
+                    elapsed
+                })
+            });
+            *ns = total.as_nanos() as f64 / (blocks.max(1) * (channels * BLOCK_SIZE) as u64) as f64;
+        }
+        rows.push((channels, ns));
+    }
+    group.finish();
+
+    println!(
+        "\n{:>8} {:>18} {:>12} {:>10} {:>8}",
+        "channels", "host_deinterleave", "interleaved", "to_planar", "speedup"
+    );
+    for &(channels, [host, interleaved, to_planar]) in &rows {
+        println!(
+            "{:>8} {:>18.3} {:>12.3} {:>10.3} {:>7.2}x",
+            channels,
+            host,
+            interleaved,
+            to_planar,
+            host / interleaved
+        );
+    }
+}
+
+criterion_group!(benches, bench_interleaved);
+criterion_main!(benches);
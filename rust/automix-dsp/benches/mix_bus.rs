@@ -0,0 +1,149 @@
+//! Mix bus summed in the gain pass against summing on the host side.
+//!
+//! For each channel count the same speech-like block is processed in place
+//! and mixed down four ways: through `process_raw` followed by a host loop
+//! that sums the output channels into a mono bus, or pans them into a
+//! stereo one, as a host had to before `automix_process_out`; and through
+//! `automix_process_out` with a mono and a stereo bus. The host loops read
+//! every channel a second time after the engine has written it.
+
+mod common;
+
+use automix_dsp::ffi::automix_process_out;
+use automix_dsp::params::{AutomixParam, ParamUpdate};
+use automix_dsp::AutomixEngine;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use std::f32::consts::FRAC_PI_4;
+use std::ptr;
+use std::time::{Duration, Instant};
+
+const CHANNEL_COUNTS: [usize; 2] = [32, 64];
+const BLOCK_SIZE: usize = 512;
+const SAMPLE_RATE: f32 = 48_000.0;
+const PATHS: [&str; 4] = ["host_mono", "fused_mono", "host_stereo", "fused_stereo"];
+
+/// Pan position of channel `c`, spread evenly from left to right.
+fn pan(c: usize, channels: usize) -> f32 {
+    c as f32 / (channels - 1) as f32 * 2.0 - 1.0
+}
+
+fn bench_mix_bus(c: &mut Criterion) {
+    let mut rows = Vec::new();
+    let mut group = c.benchmark_group("mix_bus");
+    group
+        .warm_up_time(Duration::from_millis(500))
+        .measurement_time(Duration::from_secs(2));
+
+    for &channels in &CHANNEL_COUNTS {
+        group.throughput(Throughput::Elements((channels * BLOCK_SIZE) as u64));
+        let source = common::talker_in_noise(channels, BLOCK_SIZE);
+        let pan_gains: Vec<[f32; 2]> = (0..channels)
+            .map(|c| {
+                let angle = (pan(c, channels) + 1.0) * FRAC_PI_4;
+                [angle.cos(), angle.sin()]
+            })
+            .collect();
+        let mut ns = [0.0; PATHS.len()];
+        for (path, ns) in PATHS.iter().zip(&mut ns) {
+            let mut engine = AutomixEngine::new(channels, SAMPLE_RATE, BLOCK_SIZE);
+            for c in 0..channels {
+                engine.push_param(ParamUpdate {
+                    param: AutomixParam::Pan,
+                    channel: c as u32,
+                    value: pan(c, channels),
+                    sample_offset: 0,
+                });
+            }
+            let mut buffers = source.clone();
+            let ptrs = common::channel_ptrs(&mut buffers);
+            let mut bus = [vec![0.0f32; BLOCK_SIZE], vec![0.0f32; BLOCK_SIZE]];
+            let (mut total, mut blocks) = (Duration::ZERO, 0u64);
+
+            group.bench_function(BenchmarkId::new(*path, channels), |b| {
+                b.iter_custom(|iters| {
+                    let mut elapsed = Duration::ZERO;
+                    for _ in 0..iters {
+                        for (buffer, input) in buffers.iter_mut().zip(&source) {
+                            buffer.copy_from_slice(input);
+                        }
+                        let start = Instant::now();
+                        unsafe {
+                            let engine_ptr = &mut engine as *mut AutomixEngine;
+                            let inputs = ptrs.as_ptr() as *const *const f32;
+                            let [left, right] = &mut bus;
+                            match *path {
+                                "host_mono" => {
+                                    engine.process_raw(ptrs.as_ptr(), channels, BLOCK_SIZE);
+                                    left.fill(0.0);
+                                    for buffer in &buffers {
+                                        for (y, &x) in left.iter_mut().zip(buffer) {
+                                            *y += x;
+                                        }
+                                    }
+                                }
+                                "host_stereo" => {
+                                    engine.process_raw(ptrs.as_ptr(), channels, BLOCK_SIZE);
+                                    left.fill(0.0);
+                                    right.fill(0.0);
+                                    for (buffer, [l, r]) in buffers.iter().zip(&pan_gains) {
+                                        for ((yl, yr), &x) in
+                                            left.iter_mut().zip(right.iter_mut()).zip(buffer)
+                                        {
+                                            *yl += x * l;
+                                            *yr += x * r;
+                                        }
+                                    }
+                                }
+                                "fused_mono" => automix_process_out(
+                                    engine_ptr,
+                                    inputs,
+                                    ptrs.as_ptr(),
+                                    left.as_mut_ptr(),
+                                    ptr::null_mut(),
+                                    channels as u32,
+                                    BLOCK_SIZE as u32,
+                                ),
+                                _ => automix_process_out(
+                                    engine_ptr,
+                                    inputs,
+                                    ptrs.as_ptr(),
+                                    left.as_mut_ptr(),
+                                    right.as_mut_ptr(),
+                                    channels as u32,
+                                    BLOCK_SIZE as u32,
+                                ),
+                            }
+                        }
+                        elapsed += start.elapsed();
+                    }
+                    total += elapsed;
+                    blocks += iters;
+                    elapsed
+                })
+            });
+            *ns = total.as_nanos() as f64 / (blocks.max(1) * (channels * BLOCK_SIZE) as u64) as f64;
+        }
+        rows.push((channels, ns));
+    }
+    group.finish();
+
+    println!(
+        "\n{:>8} {:>10} {:>11} {:>8} {:>12} {:>13} {:>8}",
+        "channels", "host_mono", "fused_mono", "speedup", "host_stereo", "fused_stereo", "speedup"
+    );
+    for &(channels, [host_mono, fused_mono, host_stereo, fused_stereo]) in &rows {
+        println!(
+            "{:>8} {:>10.3} {:>11.3} {:>7.2}x {:>12.3} {:>13.3} {:>7.2}x",
+            channels,
+            host_mono,
+            fused_mono,
+            host_mono / fused_mono,
+            host_stereo,
+            fused_stereo,
+            host_stereo / fused_stereo
+        );
+    }
+}
+
+criterion_group!(benches, bench_mix_bus);
+criterion_main!(benches);
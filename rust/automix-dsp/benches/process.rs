@@ -0,0 +1,291 @@
+//! `process_raw` cost across channel counts, block sizes and sample rates.
+//!
+//! Criterion reports the mean time per block. On top of that every
+//! configuration gets a timing pass of its own after Criterion is done with
+//! it: `WARM_UP` of untimed blocks, then up to `TIMING_WINDOW` blocks timed
+//! one by one, so the summary can give the cost per sample and channel
+//! together with the slow tail (p99 and worst block), which is what decides
+//! whether a configuration fits its real-time budget.
+//!
+//! The summary is compared against the baseline checked in at
+//! `benches/baselines/process_raw.json` (or the path in
+//! `AUTOMIX_BENCH_BASELINE`) and the change of each configuration is
+//! reported. Set `AUTOMIX_BENCH_SAVE_BASELINE=1` to replace the baseline
+//! with this run. The numbers only compare on the same machine and SIMD
+//! level.
+
+mod common;
+
+use automix_dsp::AutomixEngine;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use std::fmt::Write as _;
+use std::path::PathBuf;
+use std::time::{Duration, Instant};
+
+const CHANNELS: [usize; 4] = [1, 8, 16, 32];
+const BLOCK_SIZES: [usize; 8] = [16, 32, 64, 128, 256, 512, 1024, 2048];
+const SAMPLE_RATES: [f32; 4] = [44_100.0, 48_000.0, 96_000.0, 192_000.0];
+
+/// Time spent processing untimed blocks before the timing pass, as before
+/// Criterion's own measurements.
+const WARM_UP: Duration = Duration::from_millis(500);
+
+/// Longest a timing pass runs, and the most blocks it times.
+const TIMING_TIME: Duration = Duration::from_secs(1);
+const TIMING_WINDOW: usize = 100_000;
+
+/// Relative change of a median or p99 against the baseline that is flagged.
+const FLAG_CHANGE: f64 = 0.05;
+
+fn percentile(sorted: &[u64], p: f64) -> f64 {
+    let rank = ((sorted.len() - 1) as f64 * p).round() as usize;
+    sorted[rank] as f64
+}
+
+struct Summary {
+    channels: usize,
+    block_size: usize,
+    sample_rate: f32,
+    median_ns: f64,
+    p99_ns: f64,
+    max_ns: f64,
+}
+
+impl Summary {
+    fn per_sample_channel(&self, block_ns: f64) -> f64 {
+        block_ns / (self.block_size * self.channels) as f64
+    }
+
+    /// Fraction of the block's real-time duration spent at the p99 cost.
+    fn p99_load(&self) -> f64 {
+        let budget_ns = self.block_size as f64 / self.sample_rate as f64 * 1e9;
+        self.p99_ns / budget_ns
+    }
+}
+
+/// Deterministic noise bursts: every channel alternates between speech-level
+/// noise and a quiet floor on its own cycle, so the gain share keeps moving.
+fn source_block(channels: usize, block_size: usize) -> Vec<Vec<f32>> {
+    common::noise_bursts(channels, block_size, |s, c| {
+        if (s / 256 + c) % 4 == 0 {
+            0.3
+        } else {
+            0.003
+        }
+    })
+}
+
+fn bench_process_raw(c: &mut Criterion) {
+    let mut summaries = Vec::new();
+    let mut group = c.benchmark_group("process_raw");
+    group
+        .warm_up_time(WARM_UP)
+        .measurement_time(Duration::from_secs(2))
+        .sample_size(30);
+
+    for &channels in &CHANNELS {
+        for &sample_rate in &SAMPLE_RATES {
+            for &block_size in &BLOCK_SIZES {
+                let source = source_block(channels, block_size);
+                let mut buffers = source.clone();
+                let ptrs = common::channel_ptrs(&mut buffers);
+                let mut engine = AutomixEngine::new(channels, sample_rate, block_size);
+
+                group.throughput(Throughput::Elements((channels * block_size) as u64));
+                group.bench_with_input(
+                    BenchmarkId::new(format!("{channels}ch/{sample_rate}Hz"), block_size),
+                    &block_size,
+                    |b, &block_size| {
+                        b.iter_custom(|iters| {
+                            let mut total = Duration::ZERO;
+                            for _ in 0..iters {
+                                // Restore the input so repeated in-place
+                                // processing cannot decay it into denormals.
+                                for (buffer, src) in buffers.iter_mut().zip(&source) {
+                                    buffer.copy_from_slice(src);
+                                }
+                                let start = Instant::now();
+                                unsafe { engine.process_raw(ptrs.as_ptr(), channels, block_size) };
+                                total += start.elapsed();
+                            }
+                            total
+                        })
+                    },
+                );
+
+                let mut block = || {
+                    for (buffer, src) in buffers.iter_mut().zip(&source) {
+                        buffer.copy_from_slice(src);
+                    }
+                    let start = Instant::now();
+                    unsafe { engine.process_raw(ptrs.as_ptr(), channels, block_size) };
+                    start.elapsed()
+                };
+                let warm_up = Instant::now();
+                while warm_up.elapsed() < WARM_UP {
+                    block();
+                }
+                let mut sorted = Vec::with_capacity(TIMING_WINDOW);
+                let timing = Instant::now();
+                while sorted.len() < TIMING_WINDOW && timing.elapsed() < TIMING_TIME {
+                    sorted.push(block().as_nanos() as u64);
+                }
+                sorted.sort_unstable();
+                summaries.push(Summary {
+                    channels,
+                    block_size,
+                    sample_rate,
+                    median_ns: percentile(&sorted, 0.5),
+                    p99_ns: percentile(&sorted, 0.99),
+                    max_ns: *sorted.last().unwrap() as f64,
+                });
+            }
+        }
+    }
+
+    group.finish();
+    report(&summaries);
+}
+
+/// The `key` field of one result line of a baseline file.
+fn field(line: &str, key: &str) -> Option<f64> {
+    let start = line.find(&format!("\"{key}\": "))? + key.len() + 4;
+    let end = line[start..]
+        .find([',', '}'])
+        .map_or(line.len(), |end| start + end);
+    line[start..end].trim_matches('"').parse().ok()
+}
+
+/// Per-configuration medians and p99s of a baseline file, keyed by channel
+/// count, sample rate and block size.
+fn read_baseline(json: &str) -> Vec<((usize, f32, usize), f64, f64)> {
+    json.lines()
+        .filter_map(|line| {
+            let key = (
+                field(line, "channels")? as usize,
+                field(line, "sample_rate")? as f32,
+                field(line, "block_size")? as usize,
+            );
+            Some((
+                key,
+                field(line, "ns_per_sample_channel_p50")?,
+                field(line, "ns_per_sample_channel_p99")?,
+            ))
+        })
+        .collect()
+}
+
+/// Relative change from `base` to `now`, as text, flagged when it is beyond
+/// `FLAG_CHANGE`.
+fn change(now: f64, base: f64) -> String {
+    let change = now / base - 1.0;
+    let flag = if change > FLAG_CHANGE {
+        " !"
+    } else if change < -FLAG_CHANGE {
+        " +"
+    } else {
+        ""
+    };
+    format!("{:+.1}%{flag}", change * 100.0)
+}
+
+fn report(summaries: &[Summary]) {
+    let simd = format!("{:?}", AutomixEngine::new(1, 48_000.0, 16).simd_level());
+    let path = std::env::var_os("AUTOMIX_BENCH_BASELINE")
+        .map(PathBuf::from)
+        .unwrap_or_else(|| {
+            PathBuf::from(env!("CARGO_MANIFEST_DIR")).join("benches/baselines/process_raw.json")
+        });
+    let stored = std::fs::read_to_string(&path).ok();
+    let baseline = stored.as_deref().map(read_baseline).unwrap_or_default();
+    match stored.as_deref().and_then(|json| {
+        json.lines()
+            .find(|line| line.contains("\"simd\""))
+            .map(|line| line.contains(&format!("\"{simd}\"")))
+    }) {
+        None => println!("\nno baseline at {}", path.display()),
+        Some(true) => println!("\ncompared with {}", path.display()),
+        Some(false) => println!(
+            "\ncompared with {}, which was recorded at another SIMD level than {simd}",
+            path.display()
+        ),
+    }
+
+    println!(
+        "{:>4} {:>8} {:>6} {:>14} {:>14} {:>12} {:>8} {:>11} {:>11}",
+        "ch",
+        "rate",
+        "block",
+        "ns/smp/ch p50",
+        "ns/smp/ch p99",
+        "worst ns",
+        "p99 load",
+        "p50 vs base",
+        "p99 vs base"
+    );
+    for s in summaries {
+        let p50 = s.per_sample_channel(s.median_ns);
+        let p99 = s.per_sample_channel(s.p99_ns);
+        let (p50_change, p99_change) = baseline
+            .iter()
+            .find(|(key, ..)| *key == (s.channels, s.sample_rate, s.block_size))
+            .map_or(
+                ("-".to_string(), "-".to_string()),
+                |&(_, base_p50, base_p99)| (change(p50, base_p50), change(p99, base_p99)),
+            );
+        println!(
+            "{:>4} {:>8} {:>6} {:>14.3} {:>14.3} {:>12.0} {:>7.3}% {:>11} {:>11}",
+            s.channels,
+            s.sample_rate,
+            s.block_size,
+            p50,
+            p99,
+            s.max_ns,
+            s.p99_load() * 100.0,
+            p50_change,
+            p99_change
+        );
+    }
+
+    if std::env::var_os("AUTOMIX_BENCH_SAVE_BASELINE").is_none() {
+        return;
+    }
+    let mut json = String::new();
+    writeln!(json, "{{").unwrap();
+    writeln!(json, "  \"version\": \"{}\",", AutomixEngine::version()).unwrap();
+    writeln!(json, "  \"simd\": \"{simd}\",").unwrap();
+    writeln!(json, "  \"results\": [").unwrap();
+    for (i, s) in summaries.iter().enumerate() {
+        let comma = if i + 1 < summaries.len() { "," } else { "" };
+        writeln!(
+            json,
+            "    {{\"channels\": {}, \"sample_rate\": {}, \"block_size\": {}, \
+             \"ns_per_sample_channel_p50\": {:.4}, \"ns_per_sample_channel_p99\": {:.4}, \
+             \"block_ns_p50\": {:.0}, \"block_ns_p99\": {:.0}, \"block_ns_max\": {:.0}, \
+             \"p99_load\": {:.6}}}{comma}",
+            s.channels,
+            s.sample_rate,
+            s.block_size,
+            s.per_sample_channel(s.median_ns),
+            s.per_sample_channel(s.p99_ns),
+            s.median_ns,
+            s.p99_ns,
+            s.max_ns,
+            s.p99_load()
+        )
+        .unwrap();
+    }
+    writeln!(json, "  ]").unwrap();
+    writeln!(json, "}}").unwrap();
+
+    if let Some(dir) = path.parent() {
+        let _ = std::fs::create_dir_all(dir);
+    }
+    match std::fs::write(&path, json) {
+        Ok(()) => println!("baseline written to {}", path.display()),
+        Err(err) => eprintln!("could not write baseline {}: {err}", path.display()),
+    }
+}
+
+criterion_group!(benches, bench_process_raw);
+criterion_main!(benches);
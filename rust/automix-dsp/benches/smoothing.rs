@@ -0,0 +1,130 @@
+//! Cost of attack/release gain smoothing per channel and sample.
+//!
+//! The same speech-like material runs through engines with and without
+//! smoothing, per sample and at a control interval of 16. The summary
+//! reports the time per sample and channel of each and the difference,
+//! which is what the one-pole filter in the gain pass costs. For scale it
+//! also times a scalar filter that derives its coefficient with `exp()` on
+//! every sample, as a naive smoother would.
+
+mod common;
+
+use automix_dsp::{AutomixConfig, AutomixEngine};
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use std::time::{Duration, Instant};
+
+const CHANNELS: usize = 32;
+const BLOCK_SIZE: usize = 512;
+const SAMPLE_RATE: f32 = 48_000.0;
+const INTERVALS: [u32; 2] = [1, 16];
+const ATTACK_MS: f32 = 2.0;
+const RELEASE_MS: f32 = 20.0;
+
+fn engine(interval: u32, smooth: bool) -> AutomixEngine {
+    let (attack, release) = if smooth {
+        (ATTACK_MS, RELEASE_MS)
+    } else {
+        (0.0, 0.0)
+    };
+    AutomixEngine::with_config(&AutomixConfig {
+        control_interval: interval,
+        gain_attack_ms: attack,
+        gain_release_ms: release,
+        ..AutomixConfig::new(CHANNELS, SAMPLE_RATE, BLOCK_SIZE)
+    })
+}
+
+/// Per-sample smoothing of `targets` (channel-major) into `gains`, with
+/// coefficients computed from the time constants on every sample.
+fn naive_smooth(targets: &[Vec<f32>], gains: &mut [f32]) {
+    for (gain, target) in gains.iter_mut().zip(targets) {
+        for &x in target {
+            let ms = if x > *gain { ATTACK_MS } else { RELEASE_MS };
+            let coeff = 1.0 - (-1.0 / (ms * 0.001 * SAMPLE_RATE)).exp();
+            *gain += (x - *gain) * coeff;
+        }
+    }
+}
+
+fn bench_smoothing(c: &mut Criterion) {
+    let source = common::talker_in_noise(CHANNELS, BLOCK_SIZE);
+    let elements = (CHANNELS * BLOCK_SIZE) as u64;
+    let ns_per =
+        |total: Duration, blocks: u64| total.as_nanos() as f64 / (blocks.max(1) * elements) as f64;
+
+    let mut rows = Vec::new();
+    let mut group = c.benchmark_group("smoothing");
+    group
+        .warm_up_time(Duration::from_millis(500))
+        .measurement_time(Duration::from_secs(2))
+        .throughput(Throughput::Elements(elements));
+
+    for &interval in &INTERVALS {
+        let mut ns = [0.0; 2];
+        for (smooth, ns) in [false, true].into_iter().zip(&mut ns) {
+            let mut engine = engine(interval, smooth);
+            let mut buffers = source.clone();
+            let ptrs = common::channel_ptrs(&mut buffers);
+            let (mut total, mut blocks) = (Duration::ZERO, 0u64);
+
+            let name = if smooth { "on" } else { "off" };
+            group.bench_function(BenchmarkId::new(name, interval), |b| {
+                b.iter_custom(|iters| {
+                    let mut elapsed = Duration::ZERO;
+                    for _ in 0..iters {
+                        for (buffer, src) in buffers.iter_mut().zip(&source) {
+                            buffer.copy_from_slice(src);
+                        }
+                        let start = Instant::now();
+                        unsafe { engine.process_raw(ptrs.as_ptr(), CHANNELS, BLOCK_SIZE) };
+                        elapsed += start.elapsed();
+                    }
+                    total += elapsed;
+                    blocks += iters;
+                    elapsed
+                })
+            });
+            *ns = ns_per(total, blocks);
+        }
+        rows.push((interval, ns));
+    }
+
+    let targets: Vec<Vec<f32>> = source
+        .iter()
+        .map(|b| b.iter().map(|x| x.abs()).collect())
+        .collect();
+    let mut gains = vec![0.0f32; CHANNELS];
+    let (mut total, mut blocks) = (Duration::ZERO, 0u64);
+    group.bench_function("naive_exp", |b| {
+        b.iter_custom(|iters| {
+            let start = Instant::now();
+            for _ in 0..iters {
+                naive_smooth(black_box(&targets), black_box(&mut gains));
+            }
+            let elapsed = start.elapsed();
+            total += elapsed;
+            blocks += iters;
+            elapsed
+        })
+    });
+    let naive = ns_per(total, blocks);
+    group.finish();
+
+    println!(
+        "\n{:>8} {:>10} {:>10} {:>10}",
+        "interval", "off", "on", "smoothing"
+    );
+    for &(interval, [off, on]) in &rows {
+        println!(
+            "{:>8} {:>10.3} {:>10.3} {:>10.3}",
+            interval,
+            off,
+            on,
+            on - off
+        );
+    }
+    println!("naive per-sample exp() smoothing alone: {naive:.3} ns/smp/ch");
+}
+
+criterion_group!(benches, bench_smoothing);
+criterion_main!(benches);
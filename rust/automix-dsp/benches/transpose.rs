@@ -0,0 +1,73 @@
+//! Tile load/store cost: blocked 4x4 transpose vs per-element pointer gather.
+
+mod common;
+
+use automix_dsp::simd::{padded, AlignedBuf};
+use automix_dsp::transpose::{gather, scatter, transpose_in, transpose_out};
+use automix_dsp::TILE_SAMPLES;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+
+const BLOCK_SIZE: usize = 64;
+
+type TileFn = unsafe fn(*mut f32, usize, *const *mut f32, usize, usize, usize);
+type UntileFn = unsafe fn(*const f32, usize, *const *mut f32, usize, usize, usize);
+
+fn bench_tile_round_trip(c: &mut Criterion) {
+    let mut group = c.benchmark_group("tile_round_trip");
+
+    for channels in [8, 16, 32] {
+        let stride = padded(channels);
+        let mut buffers: Vec<Vec<f32>> = (0..channels)
+            .map(|ch| {
+                (0..BLOCK_SIZE)
+                    .map(|s| (ch * BLOCK_SIZE + s) as f32 * 1e-4)
+                    .collect()
+            })
+            .collect();
+        let ptrs = common::channel_ptrs(&mut buffers);
+        let mut tile = AlignedBuf::zeroed(stride * TILE_SAMPLES);
+
+        group.throughput(Throughput::Elements((channels * BLOCK_SIZE) as u64));
+
+        let paths: [(&str, TileFn, UntileFn); 2] = [
+            ("transpose", transpose_in, transpose_out),
+            ("gather", gather, scatter),
+        ];
+        for (name, load, store) in paths {
+            group.bench_with_input(
+                BenchmarkId::new(name, channels),
+                &channels,
+                |b, &channels| {
+                    b.iter(|| unsafe {
+                        let mut offset = 0;
+                        while offset < BLOCK_SIZE {
+                            load(
+                                tile.as_mut_ptr(),
+                                stride,
+                                ptrs.as_ptr(),
+                                channels,
+                                offset,
+                                TILE_SAMPLES,
+                            );
+                            black_box(tile.as_mut_ptr());
+                            store(
+                                tile.as_ptr(),
+                                stride,
+                                ptrs.as_ptr(),
+                                channels,
+                                offset,
+                                TILE_SAMPLES,
+                            );
+                            offset += TILE_SAMPLES;
+                        }
+                    })
+                },
+            );
+        }
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_tile_round_trip);
+criterion_main!(benches);
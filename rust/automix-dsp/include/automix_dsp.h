@@ -8,30 +8,257 @@
 #include <stdint.h>
 #include <stdlib.h>
 
-// Maximum number of channels supported.
-#define AUTOMIX_MAX_CHANNELS 32
+// Maximum number of channels supported. The channel count itself is fixed
+// when an engine is created, and all state is sized to it.
+#define AUTOMIX_MAX_CHANNELS 256
 
-// Core automix engine (stub for Phase 0).
+// Maximum number of gain-sharing groups. Each group shares gain among its own
+// channels only, with its own sum and its own NOM.
+#define AUTOMIX_MAX_GROUPS 8
+
+// Maximum number of engines in one link.
+#define AUTOMIX_LINK_SLOTS 64
+
+// Number of updates the ring can hold between two audio callbacks.
+#define AUTOMIX_PARAM_QUEUE_CAPACITY 1024
+
+// Largest gain-share weight. Larger weights are clamped to it, so that a
+// channel's weighted level cannot overflow its group's level sum.
+#define AUTOMIX_MAX_WEIGHT 1.0e6
+
+// Parameters that can be changed while processing.
+enum AutomixParam
+#ifdef __cplusplus
+  : uint32_t
+#endif // __cplusplus
+ {
+  // Per-channel gain-share weight, 0..AUTOMIX_MAX_WEIGHT (default 1).
+  // Non-finite values are ignored.
+  AutomixParam_Weight = 0,
+  // Per-channel solo: while any channel is soloed, the others are muted.
+  AutomixParam_Solo = 1,
+  // Per-channel mute: the channel is silenced and leaves the gain share.
+  AutomixParam_Mute = 2,
+  // Per-channel bypass: the channel passes at unity and leaves the gain share.
+  AutomixParam_Bypass = 3,
+  // NOM attenuation depth, 0..1: the fraction of the 10*log10(NOM) dB rule
+  // applied to each group (engine-wide, channel ignored). Non-finite
+  // values are ignored.
+  AutomixParam_NomDepth = 4,
+  // Last-mic-hold time in milliseconds: how long a channel that went
+  // quiet keeps its gain while no other channel of its group is open.
+  // The last channel to open keeps it until another one opens; 0 turns
+  // last-mic-hold off (engine-wide, channel ignored).
+  AutomixParam_HoldTime = 5,
+  // Per-channel gain-sharing group, 0..AUTOMIX_MAX_GROUPS (default 0).
+  AutomixParam_Group = 6,
+  // Per-channel position on a stereo mix bus, -1 (left) ..1 (right),
+  // with a constant-power pan law (default 0, -3 dB on each side).
+  // Changes glide over `max_block_size` samples; non-finite values are
+  // ignored.
+  AutomixParam_Pan = 7,
+};
+#ifndef __cplusplus
+typedef uint32_t AutomixParam;
+#endif // __cplusplus
+
+// Where linked engines may live.
+enum AutomixLinkScope
+#ifdef __cplusplus
+  : uint32_t
+#endif // __cplusplus
+ {
+  // Engines in the calling process.
+  AutomixLinkScope_Process = 0,
+  // Engines in any process on the machine, through shared memory.
+  AutomixLinkScope_Machine = 1,
+};
+#ifndef __cplusplus
+typedef uint32_t AutomixLinkScope;
+#endif // __cplusplus
+
+// Engine configuration for [`AutomixEngine::with_config`].
+typedef struct AutomixConfig {
+  uint32_t num_channels;
+  float sample_rate;
+  uint32_t max_block_size;
+  // Worker threads that share the per-channel stages with the audio
+  // thread; 0 processes everything on the calling thread. Capped so every
+  // thread gets at least one group of 16 channels.
+  uint32_t num_workers;
+  // Pin worker `i` to CPU `first_cpu + i`; negative leaves them unpinned.
+  int32_t first_cpu;
+  // SCHED_FIFO priority for the workers; 0 keeps the default policy.
+  int32_t realtime_priority;
+  // How long an idle worker spins before sleeping, in microseconds. Spin
+  // for at least one block period to keep workers hot between callbacks.
+  uint32_t worker_spin_us;
+  // Samples between level-detector and gain-share updates; gains ramp
+  // linearly in between. 0 or 1 updates every sample. Engines with a
+  // control interval above 1 process on the calling thread only.
+  uint32_t control_interval;
+  // Compute the share scales from the CPU's reciprocal estimate refined
+  // by one Newton-Raphson step instead of dividing. Gains then carry a
+  // relative error of up to 3.1e-5 (about 2e-7 on x86), see
+  // [`simd::RECIP_MAX_REL_ERROR`].
+  bool fast_reciprocal;
+  // Time constants in milliseconds with which each channel's gain
+  // follows its share while rising and while falling. 0 for both applies
+  // the shares as they are; 0 for one of them makes that direction
+  // immediate.
+  float gain_attack_ms;
+  float gain_release_ms;
+} AutomixConfig;
+
+// Meter values for one channel over the last processed block.
+typedef struct AutomixChannelMeter {
+  float input_peak;
+  float input_rms;
+  // Gain applied at the end of the block (linear).
+  float gain;
+  float output_peak;
+  float output_rms;
+} AutomixChannelMeter;
+
+// Meter snapshot for the whole engine.
+typedef struct AutomixMeters {
+  // Incremented for every published snapshot.
+  uint64_t sequence;
+  uint32_t num_channels;
+  // Effective number of open mics at the end of the block, over all
+  // groups: (sum g)^2 / sum g^2 over the shared gains.
+  float nom;
+  // Gain-sharing groups in use; entries of `group_nom` past it are zero.
+  uint32_t num_groups;
+  // Effective number of open mics in each group.
+  float group_nom[AUTOMIX_MAX_GROUPS];
+  // Open mics counted by the NOM attenuation stage, over all groups and
+  // per group.
+  uint32_t open_mics;
+  uint32_t group_open_mics[AUTOMIX_MAX_GROUPS];
+  // NOM master gain of each group at the end of the block (linear).
+  float group_nom_gain[AUTOMIX_MAX_GROUPS];
+  struct AutomixChannelMeter channels[AUTOMIX_MAX_CHANNELS];
+} AutomixMeters;
+
+// Core automix engine: Dugan-style gain sharing across all channels.
+//
+// All working memory is allocated in [`AutomixEngine::new`]; processing
+// never touches the heap.
 typedef struct AutomixEngine AutomixEngine;
 
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
 // Create a new AutomixEngine instance.
+// All working memory is allocated here, sized from `max_block_size`; processing never allocates.
 // Returns an opaque pointer that must be freed with `automix_destroy`.
 struct AutomixEngine *automix_create(uint32_t num_channels,
                                      float sample_rate,
-                                     uint32_t _max_block_size);
+                                     uint32_t max_block_size);
+
+// Create an engine from a full configuration, including the optional worker pool that splits
+// the per-channel stages of large channel counts across cores. Worker threads are started here.
+// Returns null if `config` is null; free the engine with `automix_destroy`.
+struct AutomixEngine *automix_create_ex(const struct AutomixConfig *config);
 
 // Destroy an AutomixEngine instance and free its memory.
 void automix_destroy(struct AutomixEngine *engine);
 
+// Create a replacement engine for a new channel count, sample rate or block size, with the
+// default threading options; see `automix_reconfigure_ex`.
+struct AutomixEngine *automix_reconfigure(struct AutomixEngine *engine,
+                                          uint32_t num_channels,
+                                          float sample_rate,
+                                          uint32_t max_block_size);
+
+// Create a replacement engine for `config`. Takes ownership of `engine` (which may be null):
+// the replacement adopts its learned state (envelopes, gains) at the start of its first
+// `automix_process` call, on the audio thread. `engine` is not dereferenced here, so the audio
+// thread may go on processing it until it switches to the replacement.
+// The replacement starts out unlinked; link it with `automix_link` before handing it to the
+// audio thread. If it joins the link `engine` is in, it takes over `engine`'s place there.
+// Do not pass `engine` to any other call afterwards; free it with `automix_collect_retired`.
+// Returns null if `config` is null.
+struct AutomixEngine *automix_reconfigure_ex(struct AutomixEngine *engine,
+                                             const struct AutomixConfig *config);
+
+// Free the engine replaced by `automix_reconfigure` or `automix_reconfigure_ex` once `engine`
+// has adopted its state. Call from a non-audio thread; safe while `engine` is being processed.
+// Returns true if an engine was freed.
+bool automix_collect_retired(struct AutomixEngine *engine);
+
 // Process a block of audio in-place.
 // `channel_ptrs`: array of `num_channels` pointers, each to `num_samples` f32 values.
-// Phase 0: passthrough (audio is left unmodified).
+// Each channel is scaled by its share of the summed channel levels.
+// Subnormals are flushed to zero while the block is processed, whatever the caller's
+// floating-point mode; the caller's mode is restored before returning.
 void automix_process(struct AutomixEngine *engine,
                      float *const *channel_ptrs,
                      uint32_t num_channels,
                      uint32_t num_samples);
 
+// Process a block out of place: read `num_channels` buffers from `input_ptrs` and write the
+// results to the `num_channels` buffers of `output_ptrs` (which may be `input_ptrs` itself).
+// Non-null `bus_left` receives the mix of all channels in the same pass: the plain sum if
+// `bus_right` is null, otherwise the left half of a stereo mix placed by `AutomixParam_Pan`,
+// with the right half in `bus_right`. Bus buffers hold `num_samples` floats.
+// Subnormals are flushed to zero as in `automix_process`.
+void automix_process_out(struct AutomixEngine *engine,
+                         const float *const *input_ptrs,
+                         float *const *output_ptrs,
+                         float *bus_left,
+                         float *bus_right,
+                         uint32_t num_channels,
+                         uint32_t num_samples);
+
+// Process a block of interleaved audio: `input` holds `num_frames` frames of `num_channels`
+// samples each. The result goes to `output` in the same interleaved layout if it is non-null
+// (it may be `input` itself), otherwise to the `num_channels` buffers of `output_ptrs`.
+// The frames are read and written in place, with no intermediate copy, when `num_channels` is
+// the engine's channel count and a multiple of 16 and each buffer is aligned to the vector width
+// the engine runs at: 16 bytes with SSE2 or NEON, 32 with AVX2 (so 32-byte alignment covers
+// every machine; the scalar fallback needs none).
+// Subnormals are flushed to zero as in `automix_process`.
+void automix_process_interleaved(struct AutomixEngine *engine,
+                                 const float *input,
+                                 float *output,
+                                 float *const *output_ptrs,
+                                 uint32_t num_channels,
+                                 uint32_t num_frames);
+
+// Queue a parameter change (an `AutomixParam` value) to take effect `sample_offset` samples
+// into the next processed block. Wait-free and allocation-free; call from one control thread
+// at a time. Returns false if the queue is full or `param` is unknown.
+bool automix_set_param(struct AutomixEngine *engine,
+                       uint32_t param,
+                       uint32_t channel,
+                       float value,
+                       uint32_t sample_offset);
+
+// Copy the latest meter snapshot (one struct) into `out`.
+// Wait-free and never blocks the audio thread; call from one thread at a time, e.g. an editor timer.
+// Returns false, leaving `out` untouched, if no block was processed since the last read.
+bool automix_read_meters(struct AutomixEngine *engine, struct AutomixMeters *out);
+
+// Share gain with every other engine linked under `name` (null-terminated UTF-8), either in this
+// process or, through shared memory, in any process on the machine (an `AutomixLinkScope` value).
+// Linked engines see each other's levels one block late and never wait for each other.
+// Call while `engine` is not being processed, e.g. on a fresh engine from `automix_reconfigure`
+// before handing it to the audio thread, where it takes over the place of the engine it replaces
+// if that was in the same link. Linking again under the same name and scope does nothing.
+// Returns false if the link is full or cannot be opened.
+bool automix_link(struct AutomixEngine *engine, const char *name, uint32_t scope);
+
+// Leave the engine's link, if any. Call while `engine` is not being processed.
+void automix_unlink(struct AutomixEngine *engine);
+
 // Returns a pointer to a null-terminated version string.
 const uint8_t *automix_version(void);
 
+#ifdef __cplusplus
+}  // extern "C"
+#endif  // __cplusplus
+
 #endif  /* AUTOMIX_DSP_H */
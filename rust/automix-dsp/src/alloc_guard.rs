@@ -0,0 +1,117 @@
+//! Guard against heap traffic on the audio thread.
+//!
+//! In the crate's own tests, and in builds with the `alloc-guard` feature,
+//! the crate installs a global allocator that aborts the process if it is
+//! entered while a [`NoAllocScope`] is live on the calling thread.
+//! `process_raw` holds one for its whole duration, so any allocation or free
+//! that sneaks into the audio path fails loudly in testing instead of
+//! showing up as an occasional dropout on stage. A library must not pick the
+//! global allocator of every program that links it, so otherwise the scope
+//! compiles down to nothing and the program keeps its own allocator.
+
+#[cfg(any(test, feature = "alloc-guard"))]
+mod imp {
+    use std::alloc::{GlobalAlloc, Layout, System};
+    use std::cell::Cell;
+
+    thread_local! {
+        static ARMED: Cell<bool> = const { Cell::new(false) };
+    }
+
+    pub struct GuardedAllocator;
+
+    #[global_allocator]
+    static ALLOCATOR: GuardedAllocator = GuardedAllocator;
+
+    fn check(what: &str) {
+        if ARMED
+            .try_with(|armed| armed.replace(false))
+            .unwrap_or(false)
+        {
+            eprintln!("automix-dsp: {what} inside the audio callback");
+            std::process::abort();
+        }
+    }
+
+    unsafe impl GlobalAlloc for GuardedAllocator {
+        unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+            check("allocation");
+            System.alloc(layout)
+        }
+
+        unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+            check("allocation");
+            System.alloc_zeroed(layout)
+        }
+
+        unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+            check("reallocation");
+            System.realloc(ptr, layout, new_size)
+        }
+
+        unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+            check("deallocation");
+            System.dealloc(ptr, layout)
+        }
+    }
+
+    pub fn arm(on: bool) -> bool {
+        ARMED.with(|armed| armed.replace(on))
+    }
+
+    #[cfg(test)]
+    pub fn is_armed() -> bool {
+        ARMED.with(|armed| armed.get())
+    }
+}
+
+#[cfg(not(any(test, feature = "alloc-guard")))]
+mod imp {
+    #[inline(always)]
+    pub fn arm(_on: bool) -> bool {
+        false
+    }
+}
+
+/// While alive, any heap allocation on this thread aborts (tests and the
+/// `alloc-guard` feature).
+pub struct NoAllocScope {
+    was_armed: bool,
+}
+
+impl NoAllocScope {
+    #[inline(always)]
+    pub fn enter() -> Self {
+        Self {
+            was_armed: imp::arm(true),
+        }
+    }
+}
+
+impl Drop for NoAllocScope {
+    #[inline(always)]
+    fn drop(&mut self) {
+        imp::arm(self.was_armed);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::imp::is_armed;
+    use super::*;
+
+    #[test]
+    fn test_scope_arms_and_restores() {
+        assert!(!is_armed());
+        {
+            let _outer = NoAllocScope::enter();
+            assert!(is_armed());
+            {
+                let _inner = NoAllocScope::enter();
+                assert!(is_armed());
+            }
+            assert!(is_armed());
+        }
+        assert!(!is_armed());
+    }
+}
@@ -0,0 +1,133 @@
+//! Flush-to-zero for the duration of a process call.
+//!
+//! A detector envelope decaying through a long silent tail ends up in the
+//! subnormal range, where it gets stuck: once `env * release` rounds to zero
+//! the envelope stops moving and every later multiply on it takes the slow
+//! microcoded path, on every sample of every silent channel. Plugin hosts
+//! usually switch subnormals off around their callbacks (JUCE's
+//! `ScopedNoDenormals`), but the render tool, tests and other C hosts do
+//! not, so `automix_process` does it itself: [`FlushDenormals`] sets
+//! flush-to-zero and denormals-are-zero (FTZ/DAZ in MXCSR on x86-64, FZ in
+//! FPCR on AArch64) and restores the caller's mode when dropped. Worker
+//! threads take on the mode of the thread that hands them a job.
+//!
+//! On other architectures the scope does nothing.
+
+/// While alive, subnormal inputs and results are treated as zero on this
+/// thread.
+pub struct FlushDenormals {
+    saved: imp::Word,
+}
+
+impl FlushDenormals {
+    #[inline(always)]
+    pub fn enter() -> Self {
+        let saved = imp::get();
+        imp::set(saved | imp::FLUSH);
+        Self { saved }
+    }
+}
+
+impl Drop for FlushDenormals {
+    #[inline(always)]
+    fn drop(&mut self) {
+        imp::set(self.saved);
+    }
+}
+
+/// Whether subnormal results are flushed to zero on this thread.
+#[inline(always)]
+pub fn is_flushing() -> bool {
+    imp::get() & imp::FLUSH != 0
+}
+
+#[cfg(target_arch = "x86_64")]
+mod imp {
+    use std::arch::asm;
+
+    pub type Word = u32;
+
+    /// MXCSR flush-to-zero (bit 15) and denormals-are-zero (bit 6).
+    pub const FLUSH: Word = 0x8040;
+
+    #[inline(always)]
+    pub fn get() -> Word {
+        let mut csr: Word = 0;
+        // SAFETY: stores the control register to a live local.
+        unsafe { asm!("stmxcsr [{}]", in(reg) &mut csr, options(nostack, preserves_flags)) };
+        csr
+    }
+
+    #[inline(always)]
+    pub fn set(csr: Word) {
+        // SAFETY: only the rounding and flush bits ever change from a value
+        // read with `get`.
+        unsafe { asm!("ldmxcsr [{}]", in(reg) &csr, options(nostack, preserves_flags, readonly)) };
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+mod imp {
+    use std::arch::asm;
+
+    pub type Word = u64;
+
+    /// FPCR flush-to-zero (bit 24), which covers inputs and results.
+    pub const FLUSH: Word = 1 << 24;
+
+    #[inline(always)]
+    pub fn get() -> Word {
+        let fpcr: Word;
+        // SAFETY: reading FPCR has no side effects.
+        unsafe { asm!("mrs {}, fpcr", out(reg) fpcr, options(nomem, nostack, preserves_flags)) };
+        fpcr
+    }
+
+    #[inline(always)]
+    pub fn set(fpcr: Word) {
+        // SAFETY: only the flush bit ever changes from a value read with
+        // `get`.
+        unsafe { asm!("msr fpcr, {}", in(reg) fpcr, options(nomem, nostack, preserves_flags)) };
+    }
+}
+
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+mod imp {
+    pub type Word = u32;
+
+    pub const FLUSH: Word = 0;
+
+    #[inline(always)]
+    pub fn get() -> Word {
+        0
+    }
+
+    #[inline(always)]
+    pub fn set(_: Word) {}
+}
+
+#[cfg(all(test, any(target_arch = "x86_64", target_arch = "aarch64")))]
+mod tests {
+    use super::*;
+    use std::hint::black_box;
+
+    fn subnormal_product() -> f32 {
+        black_box(1.0e-30f32) * black_box(1.0e-10f32)
+    }
+
+    #[test]
+    fn test_scope_flushes_and_restores() {
+        assert!(!is_flushing());
+        assert!(subnormal_product() > 0.0);
+        {
+            let _flush = FlushDenormals::enter();
+            assert!(is_flushing());
+            assert_eq!(subnormal_product(), 0.0);
+            // Nested scopes restore the mode they found.
+            drop(FlushDenormals::enter());
+            assert!(is_flushing());
+        }
+        assert!(!is_flushing());
+        assert!(subnormal_product() > 0.0);
+    }
+}
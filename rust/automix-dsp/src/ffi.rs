@@ -1,18 +1,39 @@
-use crate::AutomixEngine;
-use std::ffi::c_float;
+use crate::denormals::FlushDenormals;
+use crate::io::{Bus, Sink, Source};
+use crate::link::AutomixLinkScope;
+use crate::meters::AutomixMeters;
+use crate::params::{AutomixParam, ParamUpdate};
+use crate::{AutomixConfig, AutomixEngine};
+use std::ffi::{c_char, c_float, CStr};
 
 /// Create a new AutomixEngine instance.
+/// All working memory is allocated here, sized from `max_block_size`; processing never allocates.
 /// Returns an opaque pointer that must be freed with `automix_destroy`.
 #[no_mangle]
 pub unsafe extern "C" fn automix_create(
     num_channels: u32,
     sample_rate: c_float,
-    _max_block_size: u32,
+    max_block_size: u32,
 ) -> *mut AutomixEngine {
-    let engine = Box::new(AutomixEngine::new(num_channels as usize, sample_rate));
+    let engine = Box::new(AutomixEngine::new(
+        num_channels as usize,
+        sample_rate,
+        max_block_size as usize,
+    ));
     Box::into_raw(engine)
 }
 
+/// Create an engine from a full configuration, including the optional worker pool that splits
+/// the per-channel stages of large channel counts across cores. Worker threads are started here.
+/// Returns null if `config` is null; free the engine with `automix_destroy`.
+#[no_mangle]
+pub unsafe extern "C" fn automix_create_ex(config: *const AutomixConfig) -> *mut AutomixEngine {
+    if config.is_null() {
+        return std::ptr::null_mut();
+    }
+    Box::into_raw(Box::new(AutomixEngine::with_config(&*config)))
+}
+
 /// Destroy an AutomixEngine instance and free its memory.
 #[no_mangle]
 pub unsafe extern "C" fn automix_destroy(engine: *mut AutomixEngine) {
@@ -21,9 +42,54 @@ pub unsafe extern "C" fn automix_destroy(engine: *mut AutomixEngine) {
     }
 }
 
+/// Create a replacement engine for a new channel count, sample rate or block size, with the
+/// default threading options; see `automix_reconfigure_ex`.
+#[no_mangle]
+pub unsafe extern "C" fn automix_reconfigure(
+    engine: *mut AutomixEngine,
+    num_channels: u32,
+    sample_rate: c_float,
+    max_block_size: u32,
+) -> *mut AutomixEngine {
+    let config = AutomixConfig::new(num_channels as usize, sample_rate, max_block_size as usize);
+    automix_reconfigure_ex(engine, &config)
+}
+
+/// Create a replacement engine for `config`. Takes ownership of `engine` (which may be null):
+/// the replacement adopts its learned state (envelopes, gains) at the start of its first
+/// `automix_process` call, on the audio thread. `engine` is not dereferenced here, so the audio
+/// thread may go on processing it until it switches to the replacement.
+/// The replacement starts out unlinked; link it with `automix_link` before handing it to the
+/// audio thread. If it joins the link `engine` is in, it takes over `engine`'s place there.
+/// Do not pass `engine` to any other call afterwards; free it with `automix_collect_retired`.
+/// Returns null if `config` is null.
+#[no_mangle]
+pub unsafe extern "C" fn automix_reconfigure_ex(
+    engine: *mut AutomixEngine,
+    config: *const AutomixConfig,
+) -> *mut AutomixEngine {
+    if config.is_null() {
+        return std::ptr::null_mut();
+    }
+    Box::into_raw(AutomixEngine::replace(engine, &*config))
+}
+
+/// Free the engine replaced by `automix_reconfigure` or `automix_reconfigure_ex` once `engine`
+/// has adopted its state. Call from a non-audio thread; safe while `engine` is being processed.
+/// Returns true if an engine was freed.
+#[no_mangle]
+pub unsafe extern "C" fn automix_collect_retired(engine: *mut AutomixEngine) -> bool {
+    if engine.is_null() {
+        return false;
+    }
+    (*engine).collect_retired().is_some()
+}
+
 /// Process a block of audio in-place.
 /// `channel_ptrs`: array of `num_channels` pointers, each to `num_samples` f32 values.
-/// Phase 0: passthrough (audio is left unmodified).
+/// Each channel is scaled by its share of the summed channel levels.
+/// Subnormals are flushed to zero while the block is processed, whatever the caller's
+/// floating-point mode; the caller's mode is restored before returning.
 #[no_mangle]
 pub unsafe extern "C" fn automix_process(
     engine: *mut AutomixEngine,
@@ -35,9 +101,159 @@ pub unsafe extern "C" fn automix_process(
         return;
     }
     let engine = &mut *engine;
+    let _flush = FlushDenormals::enter();
     engine.process_raw(channel_ptrs, num_channels as usize, num_samples as usize);
 }
 
+/// Process a block out of place: read `num_channels` buffers from `input_ptrs` and write the
+/// results to the `num_channels` buffers of `output_ptrs` (which may be `input_ptrs` itself).
+/// Non-null `bus_left` receives the mix of all channels in the same pass: the plain sum if
+/// `bus_right` is null, otherwise the left half of a stereo mix placed by `AutomixParam_Pan`,
+/// with the right half in `bus_right`. Bus buffers hold `num_samples` floats.
+/// Subnormals are flushed to zero as in `automix_process`.
+#[no_mangle]
+pub unsafe extern "C" fn automix_process_out(
+    engine: *mut AutomixEngine,
+    input_ptrs: *const *const c_float,
+    output_ptrs: *const *mut c_float,
+    bus_left: *mut c_float,
+    bus_right: *mut c_float,
+    num_channels: u32,
+    num_samples: u32,
+) {
+    if engine.is_null() || input_ptrs.is_null() || output_ptrs.is_null() {
+        return;
+    }
+    let bus = match (bus_left.is_null(), bus_right.is_null()) {
+        (true, _) => Bus::None,
+        (false, true) => Bus::Mono(bus_left),
+        (false, false) => Bus::Stereo(bus_left, bus_right),
+    };
+    let engine = &mut *engine;
+    let _flush = FlushDenormals::enter();
+    engine.process_io(
+        Source::Planar(input_ptrs),
+        Sink::Planar(output_ptrs),
+        bus,
+        num_channels as usize,
+        num_samples as usize,
+    );
+}
+
+/// Process a block of interleaved audio: `input` holds `num_frames` frames of `num_channels`
+/// samples each. The result goes to `output` in the same interleaved layout if it is non-null
+/// (it may be `input` itself), otherwise to the `num_channels` buffers of `output_ptrs`.
+/// The frames are read and written in place, with no intermediate copy, when `num_channels` is
+/// the engine's channel count and a multiple of 16 and each buffer is aligned to the vector width
+/// the engine runs at: 16 bytes with SSE2 or NEON, 32 with AVX2 (so 32-byte alignment covers
+/// every machine; the scalar fallback needs none).
+/// Subnormals are flushed to zero as in `automix_process`.
+#[no_mangle]
+pub unsafe extern "C" fn automix_process_interleaved(
+    engine: *mut AutomixEngine,
+    input: *const c_float,
+    output: *mut c_float,
+    output_ptrs: *const *mut c_float,
+    num_channels: u32,
+    num_frames: u32,
+) {
+    if engine.is_null() || input.is_null() || (output.is_null() && output_ptrs.is_null()) {
+        return;
+    }
+    let sink = if output.is_null() {
+        Sink::Planar(output_ptrs)
+    } else {
+        Sink::Interleaved(output)
+    };
+    let engine = &mut *engine;
+    let _flush = FlushDenormals::enter();
+    engine.process_io(
+        Source::Interleaved(input),
+        sink,
+        Bus::None,
+        num_channels as usize,
+        num_frames as usize,
+    );
+}
+
+/// Queue a parameter change (an `AutomixParam` value) to take effect `sample_offset` samples
+/// into the next processed block. Wait-free and allocation-free; call from one control thread
+/// at a time. Returns false if the queue is full or `param` is unknown.
+#[no_mangle]
+pub unsafe extern "C" fn automix_set_param(
+    engine: *mut AutomixEngine,
+    param: u32,
+    channel: u32,
+    value: c_float,
+    sample_offset: u32,
+) -> bool {
+    if engine.is_null() {
+        return false;
+    }
+    let Some(param) = AutomixParam::from_u32(param) else {
+        return false;
+    };
+    (*engine).push_param(ParamUpdate {
+        param,
+        channel,
+        value,
+        sample_offset,
+    })
+}
+
+/// Copy the latest meter snapshot (one struct) into `out`.
+/// Wait-free and never blocks the audio thread; call from one thread at a time, e.g. an editor timer.
+/// Returns false, leaving `out` untouched, if no block was processed since the last read.
+#[no_mangle]
+pub unsafe extern "C" fn automix_read_meters(
+    engine: *mut AutomixEngine,
+    out: *mut AutomixMeters,
+) -> bool {
+    if engine.is_null() || out.is_null() {
+        return false;
+    }
+    match (*engine).read_meters() {
+        Some(meters) => {
+            *out = *meters;
+            true
+        }
+        None => false,
+    }
+}
+
+/// Share gain with every other engine linked under `name` (null-terminated UTF-8), either in this
+/// process or, through shared memory, in any process on the machine (an `AutomixLinkScope` value).
+/// Linked engines see each other's levels one block late and never wait for each other.
+/// Call while `engine` is not being processed, e.g. on a fresh engine from `automix_reconfigure`
+/// before handing it to the audio thread, where it takes over the place of the engine it replaces
+/// if that was in the same link. Linking again under the same name and scope does nothing.
+/// Returns false if the link is full or cannot be opened.
+#[no_mangle]
+pub unsafe extern "C" fn automix_link(
+    engine: *mut AutomixEngine,
+    name: *const c_char,
+    scope: u32,
+) -> bool {
+    if engine.is_null() || name.is_null() {
+        return false;
+    }
+    let (Ok(name), Some(scope)) = (
+        CStr::from_ptr(name).to_str(),
+        AutomixLinkScope::from_u32(scope),
+    ) else {
+        return false;
+    };
+    (*engine).link(name, scope)
+}
+
+/// Leave the engine's link, if any. Call while `engine` is not being processed.
+#[no_mangle]
+pub unsafe extern "C" fn automix_unlink(engine: *mut AutomixEngine) {
+    if !engine.is_null() {
+        (*engine).unlink();
+    }
+}
+
 /// Returns a pointer to a null-terminated version string.
 #[no_mangle]
 pub extern "C" fn automix_version() -> *const u8 {
@@ -0,0 +1,117 @@
+//! Last-mic-hold.
+//!
+//! Left alone, gain sharing hands the gain back to every channel equally as
+//! soon as a talker pauses, so the room sound of all mics swells up in every
+//! gap. Instead, while no other channel of its group is open (see
+//! [`crate::nom`]), a channel shares with at least the level it peaked at
+//! during its last utterance: while it is open itself, for `hold_ms` after
+//! it closes, and beyond that if it is the last channel of the group to
+//! have opened. As soon as another channel opens, the holds of the others
+//! are dropped and the new talker takes over.
+//!
+//! The held levels live in one per-lane array that the kernel takes the
+//! maximum with before sharing; timers and the last-opened channel of each
+//! group are only looked at once per block.
+
+use crate::nom::NomStage;
+use crate::simd::AlignedBuf;
+use crate::AUTOMIX_MAX_GROUPS;
+
+pub(crate) struct LastMicHold {
+    /// Level each lane shares with at least, zero when not held.
+    pub level: AlignedBuf,
+    /// Peak detector level of each channel's current or last utterance.
+    peak: Box<[f32]>,
+    /// Samples of hold left after each channel closed.
+    timer: Box<[u32]>,
+    /// Channel of each group that opened last.
+    last: [Option<u8>; AUTOMIX_MAX_GROUPS],
+}
+
+impl LastMicHold {
+    pub fn new(stride: usize, num_channels: usize) -> Self {
+        Self {
+            level: AlignedBuf::zeroed(stride),
+            peak: vec![0.0; num_channels].into_boxed_slice(),
+            timer: vec![0; num_channels].into_boxed_slice(),
+            last: [None; AUTOMIX_MAX_GROUPS],
+        }
+    }
+
+    /// Finish a block of `num_samples` samples: run the timers down, note
+    /// the channels that opened in it and set the levels to hold during the
+    /// next block. `hold_samples` of 0 turns holding off.
+    pub fn update(
+        &mut self,
+        num_samples: usize,
+        nom: &NomStage,
+        env: &[f32],
+        group: &[u8],
+        hold_samples: u32,
+    ) {
+        for (c, &g) in group.iter().enumerate() {
+            if nom.is_open(c) {
+                if nom.opened(c) {
+                    self.peak[c] = 0.0;
+                    self.last[g as usize] = Some(c as u8);
+                }
+                self.peak[c] = self.peak[c].max(env[c]);
+                self.timer[c] = hold_samples;
+            } else {
+                self.timer[c] = self.timer[c].saturating_sub(num_samples as u32);
+            }
+        }
+
+        for (c, &g) in group.iter().enumerate() {
+            let others = nom.count[g as usize] - nom.is_open(c) as u32;
+            let held = hold_samples > 0
+                && others == 0
+                && (self.timer[c] > 0 || self.last[g as usize] == Some(c as u8));
+            self.level[c] = if held { self.peak[c] } else { 0.0 };
+        }
+    }
+
+    /// Copy the state of the first `channels` channels from `source`.
+    pub fn adopt(&mut self, source: &LastMicHold, channels: usize) {
+        self.level[..channels].copy_from_slice(&source.level[..channels]);
+        self.peak[..channels].copy_from_slice(&source.peak[..channels]);
+        self.timer[..channels].copy_from_slice(&source.timer[..channels]);
+        self.last = source.last.map(|c| c.filter(|&c| (c as usize) < channels));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_recent_channels_hold_until_another_opens() {
+        let mut nom = NomStage::new(48000.0);
+        let mut hold = LastMicHold::new(16, 3);
+        let floor = [0.0; 3];
+        let weight = [1.0; 3];
+        let group = [0; 3];
+        // 10 ms blocks with a 100 ms hold time.
+        let mut block = |env: [f32; 3]| {
+            nom.update(480, &env, &floor, &weight, &group, 0.0);
+            hold.update(480, &nom, &env, &group, 4800);
+            [hold.level[0], hold.level[1], hold.level[2]]
+        };
+
+        // A talker alone is held from the start.
+        assert_eq!(block([0.3, 0.0, 0.0]), [0.3, 0.0, 0.0]);
+        assert_eq!(block([0.2, 0.1, 0.0]), [0.0; 3]);
+        // Both quiet: channel 0 is held at its peak, channel 1 (opened
+        // last) at its own, which covers the next 100 ms.
+        for _ in 0..9 {
+            assert_eq!(block([0.0; 3]), [0.3, 0.1, 0.0]);
+        }
+        // Channel 0's hold time is up; channel 1 stays on.
+        for _ in 0..100 {
+            assert_eq!(block([0.0; 3]), [0.0, 0.1, 0.0]);
+        }
+        // A new talker releases every hold at once.
+        assert_eq!(block([0.0, 0.0, 0.05]), [0.0, 0.0, 0.05]);
+        assert_eq!(block([0.0; 3]), [0.0, 0.0, 0.05]);
+    }
+}
@@ -0,0 +1,186 @@
+//! Where a block's samples come from and where they go.
+//!
+//! The kernel works on sample-major rows of `stride` lanes. Planar host
+//! buffers are transposed into the engine's tile and back (see
+//! [`crate::transpose`]). Interleaved frames already are sample-major rows,
+//! so they need no shuffling at all: when a frame fills whole 16-channel
+//! groups (its pitch is the tile stride) and the buffer is aligned for the
+//! vector width, the level detector loads straight from the host's frames
+//! and the gain pass stores straight into them, with no copy in between.
+//! Other frame sizes are copied into padded tile rows and back, one
+//! contiguous copy per frame.
+//!
+//! Input and output need not have the same layout, nor be the same buffers.
+//! Next to the per-channel output the engine can mix the block down to a
+//! mono or stereo [`Bus`] in the same pass (see [`crate::kernel`]).
+
+use crate::kernel::BusRows;
+use crate::simd::F32s;
+use crate::transpose::{transpose_in, transpose_out};
+use std::mem::align_of;
+use std::ptr;
+
+/// Samples the engine reads.
+#[derive(Clone, Copy, Debug)]
+pub enum Source {
+    /// One buffer per channel.
+    Planar(*const *const f32),
+    /// Frames of one sample per channel, one after the other.
+    Interleaved(*const f32),
+}
+
+/// Buffers the engine writes its output to. They may be the input buffers.
+#[derive(Clone, Copy, Debug)]
+pub enum Sink {
+    /// One buffer per channel.
+    Planar(*const *mut f32),
+    /// Frames of one sample per channel, one after the other.
+    Interleaved(*mut f32),
+}
+
+/// Mix-bus output: one buffer of the block's length per bus channel.
+#[derive(Clone, Copy, Debug)]
+pub enum Bus {
+    None,
+    /// The plain sum of all channels.
+    Mono(*mut f32),
+    /// Left and right sums of all channels, placed by their pan.
+    Stereo(*mut f32, *mut f32),
+}
+
+/// A block's input and output as the kernel sees them.
+#[derive(Clone, Copy)]
+pub(crate) struct BlockIo {
+    pub source: Source,
+    pub sink: Sink,
+    pub bus: Bus,
+    /// Channels the host passes: the number of planar buffers, or the
+    /// samples per interleaved frame.
+    pub pitch: usize,
+    /// Channels processed, at most the engine's.
+    pub channels: usize,
+}
+
+impl BlockIo {
+    /// The bus rows for sample `offset` on.
+    #[inline(always)]
+    pub fn bus_rows(&self, offset: usize) -> BusRows {
+        let (rows, channels) = match self.bus {
+            Bus::None => ([ptr::null_mut(); 2], 0),
+            Bus::Mono(mono) => ([mono, ptr::null_mut()], 1),
+            Bus::Stereo(left, right) => ([left, right], 2),
+        };
+        BusRows { rows, channels }.skip(offset)
+    }
+
+    /// Whether the frames at `frames` can be used as tile rows of `stride`
+    /// lanes by vectors of type `V`.
+    #[inline(always)]
+    fn in_place<V: F32s>(&self, frames: *const f32, stride: usize) -> bool {
+        self.pitch == stride && self.channels == stride && frames as usize % align_of::<V>() == 0
+    }
+
+    /// Where the kernel reads lane `first` of the row for sample `offset`:
+    /// the host's frames where it can read them in place, otherwise `tile`
+    /// (which points at row 0), for [`BlockIo::load`] to fill.
+    #[inline(always)]
+    pub unsafe fn source<V: F32s>(
+        &self,
+        tile: *mut f32,
+        stride: usize,
+        first: usize,
+        offset: usize,
+    ) -> *const f32 {
+        match self.source {
+            Source::Interleaved(frames) if self.in_place::<V>(frames, stride) => {
+                frames.add(offset * stride + first)
+            }
+            _ => tile.add(first),
+        }
+    }
+
+    /// Copy samples `offset..offset + rows` of lanes `first..last` into
+    /// `tile`, unless the kernel reads them in place.
+    #[inline(always)]
+    pub unsafe fn load<V: F32s>(
+        &self,
+        tile: *mut f32,
+        stride: usize,
+        first: usize,
+        last: usize,
+        offset: usize,
+        rows: usize,
+    ) {
+        let copied = self.channels.min(last).saturating_sub(first);
+        match self.source {
+            Source::Interleaved(frames) if self.in_place::<V>(frames, stride) => {}
+            Source::Interleaved(frames) => {
+                for r in 0..rows {
+                    ptr::copy_nonoverlapping(
+                        frames.add((offset + r) * self.pitch + first),
+                        tile.add(r * stride + first),
+                        copied,
+                    );
+                }
+            }
+            Source::Planar(channel_ptrs) => {
+                if copied > 0 {
+                    let channel_ptrs = channel_ptrs.add(first) as *const *mut f32;
+                    transpose_in(tile.add(first), stride, channel_ptrs, copied, offset, rows);
+                }
+            }
+        }
+    }
+
+    /// Where the kernel writes lane `first` of the row for sample `offset`:
+    /// the host's frames where it can write them in place, otherwise `tile`,
+    /// for [`BlockIo::store`] to copy out.
+    #[inline(always)]
+    pub unsafe fn target<V: F32s>(
+        &self,
+        tile: *mut f32,
+        stride: usize,
+        first: usize,
+        offset: usize,
+    ) -> *mut f32 {
+        match self.sink {
+            Sink::Interleaved(frames) if self.in_place::<V>(frames, stride) => {
+                frames.add(offset * stride + first)
+            }
+            _ => tile.add(first),
+        }
+    }
+
+    /// Copy the rows the kernel wrote to `tile` out to the host's buffers,
+    /// unless it wrote them there directly.
+    #[inline(always)]
+    pub unsafe fn store<V: F32s>(
+        &self,
+        tile: *const f32,
+        stride: usize,
+        first: usize,
+        last: usize,
+        offset: usize,
+        rows: usize,
+    ) {
+        let copied = self.channels.min(last).saturating_sub(first);
+        match self.sink {
+            Sink::Interleaved(frames) if self.in_place::<V>(frames, stride) => {}
+            Sink::Interleaved(frames) => {
+                for r in 0..rows {
+                    ptr::copy_nonoverlapping(
+                        tile.add(r * stride + first),
+                        frames.add((offset + r) * self.pitch + first),
+                        copied,
+                    );
+                }
+            }
+            Sink::Planar(channel_ptrs) => {
+                if copied > 0 {
+                    let channel_ptrs = channel_ptrs.add(first);
+                    transpose_out(tile.add(first), stride, channel_ptrs, copied, offset, rows);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,692 @@
+//! Dugan gain-sharing kernel.
+//!
+//! The kernel works on a tile of `rows` samples laid out sample-major: row `r`
+//! holds every channel's value at one sample index, padded to `stride` lanes.
+//! It reads the rows from `src` and writes them to `dst`, which may be the
+//! same rows; both are usually the engine's tile, but can be the host's
+//! interleaved frames directly when those have the tile's layout (see
+//! [`crate::io`]). For each row it updates the per-channel level detector,
+//! sums the levels across channels and scales each channel by its share of
+//! that sum, so the gains of all channels always add up to one.
+//!
+//! The level a channel shares with is its detector envelope, raised to its
+//! held level while last-mic-hold keeps it on (see [`crate::hold`]), less
+//! its noise floor (see [`crate::noise`]); the kernel also keeps the running
+//! minimum the floor estimate is built from.
+//!
+//! Channels can be split into independent groups, each with its own sum. The
+//! single-group case runs exactly as above; with several groups the detector
+//! pass is unchanged and a second sweep over the (L1-resident) level rows
+//! adds each group's lanes up under its membership mask.
+//!
+//! In control-rate mode the detector and the share run once per control
+//! interval instead of once per sample: [`ramp_rows`] applies a linear gain
+//! ramp and collects each channel's peak, and [`control_update`] feeds that
+//! peak to the detector at the end of the interval and sets the ramp towards
+//! the new gains, one division per interval instead of one per sample.
+//!
+//! A channel's weight is stored premultiplied: next to the weight itself
+//! the engine keeps `LEVEL_FLOOR` times the weight, so weighting the level
+//! is a single fused multiply-add. While a weight change ramps in, the
+//! detector pass (a separate instantiation, so steady weights cost nothing)
+//! steps the weights along once per row.
+//!
+//! Each group's share scale is multiplied by its NOM master gain (see
+//! [`crate::nom`]) before it is applied, a per-row scalar product that costs
+//! nothing per channel.
+//!
+//! With gain smoothing configured, the gains do not jump to their shares
+//! but follow them through a one-pole filter per channel, with separate
+//! attack (rising) and release (falling) coefficients the engine computes
+//! once at create time. The filter runs in the gain pass (again a separate
+//! instantiation), one select and one fused multiply-add per row and vector
+//! of channels; in control-rate mode the ramp targets are filtered instead.
+//!
+//! The gain pass can also mix its output down to a mono or stereo bus: next
+//! to the output it adds each row's samples up (weighted by the lanes' pan
+//! gains for stereo) in registers, so the bus costs no second read of the
+//! channel data. Like the share sums, the bus sums are per slice of lanes
+//! and the engine adds up the slices of a worker pool.
+//!
+//! Both passes walk the tile one vector of channels at a time and run down all
+//! rows before moving on, so a channel's detector and meter state is loaded
+//! once per tile and stays in registers. The stride is padded to 16-channel
+//! groups, one cache line of each per-channel array, which keeps the working
+//! set of a 256-channel engine on one core's caches.
+
+use crate::nom::NomRamp;
+use crate::simd::F32s;
+use crate::AUTOMIX_MAX_GROUPS;
+
+/// Number of samples processed per tile.
+pub const TILE_SAMPLES: usize = 16;
+
+/// Level added to every active channel so silence shares gain equally
+/// instead of dividing by zero (about -100 dBFS).
+pub const LEVEL_FLOOR: f32 = 1.0e-5;
+
+/// Pointers into the engine state the kernel reads and writes.
+///
+/// Every per-channel buffer is cache-line aligned; the kernel touches lanes
+/// `0..lanes` of them, and `stride` is the row pitch of the tile and level
+/// buffers. Channels that take no part in the share, and padding lanes, have
+/// a zero `share_weight` so they never contribute to the sum; `pass_gain` is
+/// added to every channel's share (one for bypassed channels). The two lane
+/// arrays are how the solo/mute/bypass switches reach the kernel: a silenced
+/// lane has both zero and a bypassed one a zero weight and a pass gain of
+/// one, so its gain comes out as exactly 0 or 1 with no branch per channel.
+/// `level_floor` is `LEVEL_FLOOR * share_weight` per lane; with
+/// `ramp_weights` set, detection adds `weight_step` to the weights on every
+/// row and writes them back. The peak and energy (sum of squares)
+/// accumulators collect meter data for the block.
+/// The envelope is raised to at least `hold` and `noise_floor` subtracted
+/// from it before sharing; `noise_min` tracks the envelope's minimum for the
+/// noise-floor estimate.
+/// `group_masks` holds `AUTOMIX_MAX_GROUPS` rows of `stride` lane masks, of
+/// which the first `groups` are in use, and `bus_gain` two rows of left and
+/// right stereo bus gains, which move by `bus_step` on every row while
+/// `ramp_weights` is set.
+/// With `smooth` set, `gain` holds each lane's smoothed gain, which moves
+/// towards its share by `gain_attack` or `gain_release` of the difference
+/// per update.
+pub(crate) struct Share {
+    pub stride: usize,
+    pub lanes: usize,
+    pub env: *mut f32,
+    pub noise_min: *mut f32,
+    pub noise_floor: *const f32,
+    pub hold: *const f32,
+    pub gain: *mut f32,
+    pub share_weight: *mut f32,
+    pub level_floor: *mut f32,
+    pub weight_step: *const f32,
+    pub ramp_weights: bool,
+    pub pass_gain: *const f32,
+    pub in_peak: *mut f32,
+    pub in_energy: *mut f32,
+    pub out_peak: *mut f32,
+    pub out_energy: *mut f32,
+    pub attack: f32,
+    pub release: f32,
+    pub smooth: bool,
+    pub gain_attack: f32,
+    pub gain_release: f32,
+    pub groups: usize,
+    pub group_masks: *const f32,
+    pub bus_gain: *mut f32,
+    pub bus_step: *const f32,
+    /// Control-rate mode only: peak of each lane since the last control
+    /// update, and the per-sample gain increment of the current ramp.
+    pub ctrl_peak: *mut f32,
+    pub gain_step: *mut f32,
+    /// Per-group level of linked engines, added to every row's sum.
+    pub remote: [f32; AUTOMIX_MAX_GROUPS],
+    /// Share scales from [`F32s::recip`] instead of exact division.
+    pub fast_recip: bool,
+    /// Per-group NOM master gain over the current block.
+    pub nom: NomRamp,
+}
+
+impl Share {
+    /// The same state restricted to lanes `first..first + lanes`. `first`
+    /// must be a multiple of the widest vector.
+    pub unsafe fn slice(&self, first: usize, lanes: usize) -> Share {
+        Share {
+            stride: self.stride,
+            lanes,
+            env: self.env.add(first),
+            noise_min: self.noise_min.add(first),
+            noise_floor: self.noise_floor.add(first),
+            hold: self.hold.add(first),
+            gain: self.gain.add(first),
+            share_weight: self.share_weight.add(first),
+            level_floor: self.level_floor.add(first),
+            weight_step: self.weight_step.add(first),
+            ramp_weights: self.ramp_weights,
+            pass_gain: self.pass_gain.add(first),
+            in_peak: self.in_peak.add(first),
+            in_energy: self.in_energy.add(first),
+            out_peak: self.out_peak.add(first),
+            out_energy: self.out_energy.add(first),
+            attack: self.attack,
+            release: self.release,
+            smooth: self.smooth,
+            gain_attack: self.gain_attack,
+            gain_release: self.gain_release,
+            groups: self.groups,
+            group_masks: self.group_masks.add(first),
+            bus_gain: self.bus_gain.add(first),
+            bus_step: self.bus_step.add(first),
+            ctrl_peak: self.ctrl_peak.add(first),
+            gain_step: self.gain_step.add(first),
+            remote: self.remote,
+            fast_recip: self.fast_recip,
+            nom: self.nom,
+        }
+    }
+}
+
+/// Run gain sharing over `rows` (1..=`TILE_SAMPLES`) sample rows from `src`
+/// to `dst`, the first of which is sample `at` of the block, mixing them
+/// into `bus`. `levels` is scratch space of the same shape as the tile.
+#[inline(always)]
+pub(crate) unsafe fn share_rows<V: F32s>(
+    k: &Share,
+    src: *const f32,
+    dst: *mut f32,
+    levels: *mut f32,
+    rows: usize,
+    at: usize,
+    bus: BusRows,
+) {
+    let mut sums = RowSums([0.0; AUTOMIX_MAX_GROUPS * TILE_SAMPLES]);
+    detect_rows::<V>(k, src, levels, rows, &mut sums.0, TILE_SAMPLES);
+    for g in 0..k.groups {
+        share_scales::<V>(k, g, sums.0.as_mut_ptr().add(g * TILE_SAMPLES), rows, at);
+    }
+    apply_rows::<V>(k, src, dst, levels, rows, &sums.0, TILE_SAMPLES, bus);
+}
+
+/// Where the gain pass writes its mix-bus rows: one pointer per bus
+/// channel, the first `channels` of which are in use (one for mono, two for
+/// left and right). Row `r` of each gets the sum of that row's output over
+/// the slice's lanes.
+#[derive(Clone, Copy)]
+pub(crate) struct BusRows {
+    pub rows: [*mut f32; 2],
+    pub channels: usize,
+}
+
+impl BusRows {
+    /// The same buses from row `rows` on.
+    #[inline(always)]
+    pub fn skip(self, rows: usize) -> BusRows {
+        BusRows {
+            rows: self.rows.map(|row| row.wrapping_add(rows)),
+            ..self
+        }
+    }
+}
+
+/// Per-group row sums, aligned for vector loads.
+#[repr(C, align(64))]
+pub(crate) struct RowSums<const N: usize>(pub [f32; N]);
+
+/// Scale that turns summed levels into shares. A sum is only zero when no
+/// channel takes part, and then every level is zero too.
+#[inline(always)]
+pub(crate) fn share_scale(sum: f32) -> f32 {
+    1.0 / sum.max(f32::MIN_POSITIVE)
+}
+
+/// Replace `len` row sums of group `g` at `sums`, the first for sample `at`
+/// of the block, by the share scales for those sums plus the remote level,
+/// including the group's NOM master gain. `sums` must be vector aligned and
+/// readable up to the next whole vector; the fast path converts whole
+/// vectors.
+#[inline(always)]
+pub(crate) unsafe fn share_scales<V: F32s>(
+    k: &Share,
+    g: usize,
+    sums: *mut f32,
+    len: usize,
+    at: usize,
+) {
+    let remote = k.remote[g];
+    if k.fast_recip {
+        let min = V::splat(f32::MIN_POSITIVE);
+        let remote = V::splat(remote);
+        let mut i = 0;
+        while i < len {
+            let sum = V::load(sums.add(i)).add(remote).max(min);
+            sum.recip().store(sums.add(i));
+            i += V::LANES;
+        }
+    } else {
+        for i in 0..len {
+            *sums.add(i) = share_scale(*sums.add(i) + remote);
+        }
+    }
+    if !k.nom.is_unity(g) {
+        for i in 0..len {
+            *sums.add(i) *= k.nom.at(g, at + i + 1);
+        }
+    }
+}
+
+/// Pass 1: level detection on the rows at `src`. Writes every lane's
+/// weighted level to `levels` and, per group `g` and row `r`, the sum over
+/// this slice's lanes to `sums[g * pitch + r]`, adding channels in ascending
+/// order.
+#[inline(always)]
+pub(crate) unsafe fn detect_rows<V: F32s>(
+    k: &Share,
+    src: *const f32,
+    levels: *mut f32,
+    rows: usize,
+    sums: &mut [f32],
+    pitch: usize,
+) {
+    if k.ramp_weights {
+        detect::<V, true>(k, src, levels, rows, sums, pitch)
+    } else {
+        detect::<V, false>(k, src, levels, rows, sums, pitch)
+    }
+}
+
+#[inline(always)]
+unsafe fn detect<V: F32s, const RAMP: bool>(
+    k: &Share,
+    src: *const f32,
+    levels: *mut f32,
+    rows: usize,
+    sums: &mut [f32],
+    pitch: usize,
+) {
+    let attack = V::splat(k.attack);
+    let release = V::splat(k.release);
+    let level_floor = V::splat(LEVEL_FLOOR);
+    let zero = V::splat(0.0);
+
+    let mut acc = [V::splat(0.0); TILE_SAMPLES];
+    let mut j = 0;
+    while j < k.lanes {
+        let mut weight = V::load(k.share_weight.add(j));
+        let mut floor = V::load(k.level_floor.add(j));
+        let step = if RAMP {
+            V::load(k.weight_step.add(j))
+        } else {
+            zero
+        };
+        let mut env = V::load(k.env.add(j));
+        let mut env_min = V::load(k.noise_min.add(j));
+        let noise = V::load(k.noise_floor.add(j));
+        let hold = V::load(k.hold.add(j));
+        let mut peak = V::load(k.in_peak.add(j));
+        let mut energy = V::load(k.in_energy.add(j));
+        for (r, acc) in acc.iter_mut().enumerate().take(rows) {
+            let x = V::load(src.add(r * k.stride + j));
+            let rect = x.abs();
+            peak = peak.max(rect);
+            energy = x.mul_add(x, energy);
+
+            let coeff = V::select(rect.gt(env), attack, release);
+            env = rect.sub(env).mul_add(coeff, env);
+            env_min = env_min.min(env);
+
+            if RAMP {
+                weight = weight.add(step);
+                floor = weight.mul(level_floor);
+            }
+            let level = env.max(hold).sub(noise).max(zero);
+            let level = level.mul_add(weight, floor);
+            level.store(levels.add(r * k.stride + j));
+            *acc = acc.add(level);
+        }
+        if RAMP {
+            weight.store(k.share_weight.add(j));
+            floor.store(k.level_floor.add(j));
+        }
+        env.store(k.env.add(j));
+        env_min.store(k.noise_min.add(j));
+        peak.store(k.in_peak.add(j));
+        energy.store(k.in_energy.add(j));
+        j += V::LANES;
+    }
+
+    if k.groups == 1 {
+        for (sum, acc) in sums.iter_mut().zip(&acc).take(rows) {
+            *sum = acc.hsum();
+        }
+    } else {
+        sum_groups::<V>(k, levels, rows, sums, pitch);
+    }
+}
+
+/// Per-group row sums of `levels` for engines with more than one group.
+#[inline(always)]
+unsafe fn sum_groups<V: F32s>(
+    k: &Share,
+    levels: *const f32,
+    rows: usize,
+    sums: &mut [f32],
+    pitch: usize,
+) {
+    let zero = V::splat(0.0);
+    for r in 0..rows {
+        let mut acc = [zero; AUTOMIX_MAX_GROUPS];
+        let mut j = 0;
+        while j < k.lanes {
+            let level = V::load(levels.add(r * k.stride + j));
+            for (g, acc) in acc.iter_mut().enumerate().take(k.groups) {
+                let mask = V::load(k.group_masks.add(g * k.stride + j));
+                *acc = acc.add(V::select(mask, level, zero));
+            }
+            j += V::LANES;
+        }
+        for (g, acc) in acc.iter().enumerate().take(k.groups) {
+            sums[g * pitch + r] = acc.hsum();
+        }
+    }
+}
+
+/// Pass 2: scale each row's levels by the `scales[g * pitch + r]` entry of
+/// their group to get the gains (or, smoothing, the gains' targets), and
+/// apply them to the rows at `src`, writing the result to `dst` and mixing
+/// it into `bus`.
+#[allow(clippy::too_many_arguments)]
+#[inline(always)]
+pub(crate) unsafe fn apply_rows<V: F32s>(
+    k: &Share,
+    src: *const f32,
+    dst: *mut f32,
+    levels: *const f32,
+    rows: usize,
+    scales: &[f32],
+    pitch: usize,
+    bus: BusRows,
+) {
+    match bus.channels {
+        0 => apply_variant::<V, 0>(k, src, dst, levels, rows, scales, pitch, bus),
+        1 => apply_variant::<V, 1>(k, src, dst, levels, rows, scales, pitch, bus),
+        _ => apply_variant::<V, 2>(k, src, dst, levels, rows, scales, pitch, bus),
+    }
+}
+
+#[allow(clippy::too_many_arguments)]
+#[inline(always)]
+unsafe fn apply_variant<V: F32s, const BUS: usize>(
+    k: &Share,
+    src: *const f32,
+    dst: *mut f32,
+    levels: *const f32,
+    rows: usize,
+    scales: &[f32],
+    pitch: usize,
+    bus: BusRows,
+) {
+    match (k.groups == 1, k.smooth) {
+        (true, false) => {
+            apply::<V, false, false, BUS>(k, src, dst, levels, rows, scales, pitch, bus)
+        }
+        (true, true) => apply::<V, false, true, BUS>(k, src, dst, levels, rows, scales, pitch, bus),
+        (false, false) => {
+            apply::<V, true, false, BUS>(k, src, dst, levels, rows, scales, pitch, bus)
+        }
+        (false, true) => apply::<V, true, true, BUS>(k, src, dst, levels, rows, scales, pitch, bus),
+    }
+}
+
+#[allow(clippy::too_many_arguments)]
+#[inline(always)]
+unsafe fn apply<V: F32s, const GROUPED: bool, const SMOOTH: bool, const BUS: usize>(
+    k: &Share,
+    src: *const f32,
+    dst: *mut f32,
+    levels: *const f32,
+    rows: usize,
+    scales: &[f32],
+    pitch: usize,
+    bus: BusRows,
+) {
+    let zero = V::splat(0.0);
+    let attack = V::splat(k.gain_attack);
+    let release = V::splat(k.gain_release);
+    let mut mix = [[zero; TILE_SAMPLES]; 2];
+    let mut j = 0;
+    while j < k.lanes {
+        let mut pan = load_bus::<V, BUS>(k.bus_gain, k.stride, j);
+        let pan_step = load_bus::<V, BUS>(k.bus_step, k.stride, j);
+        let pass = V::load(k.pass_gain.add(j));
+        let mut peak = V::load(k.out_peak.add(j));
+        let mut energy = V::load(k.out_energy.add(j));
+        let mut masks = [zero; AUTOMIX_MAX_GROUPS];
+        if GROUPED {
+            for (g, mask) in masks.iter_mut().enumerate().take(k.groups) {
+                *mask = V::load(k.group_masks.add(g * k.stride + j));
+            }
+        }
+        let mut gain = if SMOOTH { V::load(k.gain.add(j)) } else { pass };
+        for r in 0..rows {
+            let scale = if GROUPED {
+                let mut scale = zero;
+                for (g, &mask) in masks.iter().enumerate().take(k.groups) {
+                    scale = V::select(mask, V::splat(scales[g * pitch + r]), scale);
+                }
+                scale
+            } else {
+                V::splat(scales[r])
+            };
+            let target = V::load(levels.add(r * k.stride + j)).mul_add(scale, pass);
+            gain = if SMOOTH {
+                let coeff = V::select(target.gt(gain), attack, release);
+                target.sub(gain).mul_add(coeff, gain)
+            } else {
+                target
+            };
+            let pos = r * k.stride + j;
+            let y = V::load(src.add(pos)).mul(gain);
+            y.store(dst.add(pos));
+            peak = peak.max(y.abs());
+            energy = y.mul_add(y, energy);
+            if BUS == 2 && k.ramp_weights {
+                pan = [pan[0].add(pan_step[0]), pan[1].add(pan_step[1])];
+            }
+            mix_row::<V, BUS>(&mut mix, r, y, pan);
+        }
+        if BUS == 2 && k.ramp_weights {
+            store_bus(k.bus_gain, k.stride, j, pan);
+        }
+        gain.store(k.gain.add(j));
+        peak.store(k.out_peak.add(j));
+        energy.store(k.out_energy.add(j));
+        j += V::LANES;
+    }
+    store_mix::<V, BUS>(&mix, rows, bus);
+}
+
+/// Left and right rows of `bus` (bus gains or their steps) at lanes `j`,
+/// for a stereo bus.
+#[inline(always)]
+unsafe fn load_bus<V: F32s, const BUS: usize>(bus: *const f32, stride: usize, j: usize) -> [V; 2] {
+    if BUS == 2 {
+        [V::load(bus.add(j)), V::load(bus.add(stride + j))]
+    } else {
+        [V::splat(0.0); 2]
+    }
+}
+
+#[inline(always)]
+unsafe fn store_bus<V: F32s>(bus: *mut f32, stride: usize, j: usize, pan: [V; 2]) {
+    pan[0].store(bus.add(j));
+    pan[1].store(bus.add(stride + j));
+}
+
+/// Add output row `r` to the bus accumulators: unweighted for mono, by the
+/// pan gains for stereo.
+#[inline(always)]
+unsafe fn mix_row<V: F32s, const BUS: usize>(
+    mix: &mut [[V; TILE_SAMPLES]; 2],
+    r: usize,
+    y: V,
+    pan: [V; 2],
+) {
+    if BUS == 1 {
+        mix[0][r] = mix[0][r].add(y);
+    } else if BUS == 2 {
+        mix[0][r] = y.mul_add(pan[0], mix[0][r]);
+        mix[1][r] = y.mul_add(pan[1], mix[1][r]);
+    }
+}
+
+#[inline(always)]
+unsafe fn store_mix<V: F32s, const BUS: usize>(
+    mix: &[[V; TILE_SAMPLES]; 2],
+    rows: usize,
+    bus: BusRows,
+) {
+    for (row, mix) in bus.rows.iter().zip(mix).take(BUS) {
+        for (r, acc) in mix.iter().enumerate().take(rows) {
+            *row.add(r) = acc.hsum();
+        }
+    }
+}
+
+/// Control-rate mode, per sample: advance each lane's gain ramp over `rows`
+/// rows from `src` to `dst` and apply it, mixing the result into `bus` and
+/// collecting the input peak for the next [`control_update`].
+#[inline(always)]
+pub(crate) unsafe fn ramp_rows<V: F32s>(
+    k: &Share,
+    src: *const f32,
+    dst: *mut f32,
+    rows: usize,
+    bus: BusRows,
+) {
+    match bus.channels {
+        0 => ramp::<V, 0>(k, src, dst, rows, bus),
+        1 => ramp::<V, 1>(k, src, dst, rows, bus),
+        _ => ramp::<V, 2>(k, src, dst, rows, bus),
+    }
+}
+
+#[inline(always)]
+unsafe fn ramp<V: F32s, const BUS: usize>(
+    k: &Share,
+    src: *const f32,
+    dst: *mut f32,
+    rows: usize,
+    bus: BusRows,
+) {
+    let mut mix = [[V::splat(0.0); TILE_SAMPLES]; 2];
+    let mut j = 0;
+    while j < k.lanes {
+        let mut pan = load_bus::<V, BUS>(k.bus_gain, k.stride, j);
+        let pan_step = load_bus::<V, BUS>(k.bus_step, k.stride, j);
+        let mut gain = V::load(k.gain.add(j));
+        let step = V::load(k.gain_step.add(j));
+        let mut ctrl_peak = V::load(k.ctrl_peak.add(j));
+        let mut in_peak = V::load(k.in_peak.add(j));
+        let mut in_energy = V::load(k.in_energy.add(j));
+        let mut out_peak = V::load(k.out_peak.add(j));
+        let mut out_energy = V::load(k.out_energy.add(j));
+        for r in 0..rows {
+            let pos = r * k.stride + j;
+            let x = V::load(src.add(pos));
+            let rect = x.abs();
+            ctrl_peak = ctrl_peak.max(rect);
+            in_peak = in_peak.max(rect);
+            in_energy = x.mul_add(x, in_energy);
+
+            gain = gain.add(step);
+            let y = x.mul(gain);
+            y.store(dst.add(pos));
+            out_peak = out_peak.max(y.abs());
+            out_energy = y.mul_add(y, out_energy);
+            if BUS == 2 && k.ramp_weights {
+                pan = [pan[0].add(pan_step[0]), pan[1].add(pan_step[1])];
+            }
+            mix_row::<V, BUS>(&mut mix, r, y, pan);
+        }
+        if BUS == 2 && k.ramp_weights {
+            store_bus(k.bus_gain, k.stride, j, pan);
+        }
+        gain.store(k.gain.add(j));
+        ctrl_peak.store(k.ctrl_peak.add(j));
+        in_peak.store(k.in_peak.add(j));
+        in_energy.store(k.in_energy.add(j));
+        out_peak.store(k.out_peak.add(j));
+        out_energy.store(k.out_energy.add(j));
+        j += V::LANES;
+    }
+    store_mix::<V, BUS>(&mix, rows, bus);
+}
+
+/// Control-rate mode, per tile while a weight change ramps in: step the
+/// weights along by `rows` rows.
+#[inline(always)]
+pub(crate) unsafe fn ramp_weights<V: F32s>(k: &Share, rows: usize) {
+    let rows = V::splat(rows as f32);
+    let level_floor = V::splat(LEVEL_FLOOR);
+    let mut j = 0;
+    while j < k.lanes {
+        let step = V::load(k.weight_step.add(j));
+        let weight = step.mul_add(rows, V::load(k.share_weight.add(j)));
+        weight.store(k.share_weight.add(j));
+        weight.mul(level_floor).store(k.level_floor.add(j));
+        j += V::LANES;
+    }
+}
+
+/// Control-rate mode, once per `interval` samples: run the detector on the
+/// interval's peak (with `attack`/`release` set for the control rate), share
+/// the resulting levels and start ramps that reach the new gains at the end
+/// of the next interval (smoothed towards them, with `gain_attack` and
+/// `gain_release` set for the control rate). The interval ends after sample
+/// `at` of the block; `levels` is scratch space for one row.
+#[inline(always)]
+pub(crate) unsafe fn control_update<V: F32s>(
+    k: &Share,
+    levels: *mut f32,
+    interval: usize,
+    at: usize,
+) {
+    let attack = V::splat(k.attack);
+    let release = V::splat(k.release);
+    let zero = V::splat(0.0);
+
+    let mut acc = zero;
+    let mut j = 0;
+    while j < k.lanes {
+        let rect = V::load(k.ctrl_peak.add(j));
+        let mut env = V::load(k.env.add(j));
+        let coeff = V::select(rect.gt(env), attack, release);
+        env = rect.sub(env).mul_add(coeff, env);
+        env.store(k.env.add(j));
+        V::load(k.noise_min.add(j))
+            .min(env)
+            .store(k.noise_min.add(j));
+        zero.store(k.ctrl_peak.add(j));
+
+        let noise = V::load(k.noise_floor.add(j));
+        let hold = V::load(k.hold.add(j));
+        let weight = V::load(k.share_weight.add(j));
+        let floor = V::load(k.level_floor.add(j));
+        let level = env.max(hold).sub(noise).max(zero);
+        let level = level.mul_add(weight, floor);
+        level.store(levels.add(j));
+        acc = acc.add(level);
+        j += V::LANES;
+    }
+
+    let mut scales = [0.0f32; AUTOMIX_MAX_GROUPS];
+    if k.groups == 1 {
+        scales[0] = acc.hsum();
+    } else {
+        sum_groups::<V>(k, levels, 1, &mut scales, 1);
+    }
+    for (g, scale) in scales.iter_mut().enumerate().take(k.groups) {
+        *scale = share_scale(*scale + k.remote[g]) * k.nom.at(g, at + interval);
+    }
+
+    let per_sample = V::splat(1.0 / interval as f32);
+    let gain_attack = V::splat(k.gain_attack);
+    let gain_release = V::splat(k.gain_release);
+    j = 0;
+    while j < k.lanes {
+        let mut scale = V::splat(scales[0]);
+        for (g, &group_scale) in scales.iter().enumerate().take(k.groups).skip(1) {
+            let mask = V::load(k.group_masks.add(g * k.stride + j));
+            scale = V::select(mask, V::splat(group_scale), scale);
+        }
+        let pass = V::load(k.pass_gain.add(j));
+        let mut target = V::load(levels.add(j)).mul_add(scale, pass);
+        let gain = V::load(k.gain.add(j));
+        if k.smooth {
+            let coeff = V::select(target.gt(gain), gain_attack, gain_release);
+            target = target.sub(gain).mul_add(coeff, gain);
+        }
+        target.sub(gain).mul(per_sample).store(k.gain_step.add(j));
+        j += V::LANES;
+    }
+}
@@ -1,46 +1,1019 @@
+mod alloc_guard;
+pub mod denormals;
 pub mod ffi;
+mod hold;
+pub mod io;
+mod kernel;
+pub mod link;
+pub mod meters;
+mod noise;
+mod nom;
+mod parallel;
+pub mod params;
+mod pool;
+pub mod simd;
+pub mod transpose;
 
-/// Maximum number of channels supported.
-pub const AUTOMIX_MAX_CHANNELS: usize = 32;
+pub use kernel::TILE_SAMPLES;
 
-/// Core automix engine (stub for Phase 0).
+use alloc_guard::NoAllocScope;
+use hold::LastMicHold;
+use io::{BlockIo, Bus, Sink, Source};
+use kernel::{BusRows, Share, LEVEL_FLOOR};
+use link::{AutomixLinkScope, LinkPeers, Member};
+use meters::{AutomixChannelMeter, AutomixMeters, MeterBus};
+use noise::NoiseFloor;
+use nom::NomStage;
+use parallel::{ParallelSpan, PARTIALS_PER_PARTICIPANT, SEGMENT_ROWS};
+use params::{ChannelParams, ParamQueue, ParamUpdate, AUTOMIX_PARAM_QUEUE_CAPACITY};
+use pool::{JobFn, PoolOptions, WorkerPool};
+#[cfg(target_arch = "aarch64")]
+use simd::Neon;
+use simd::{padded, AlignedBuf, F32s, SimdLevel, LANE_PAD};
+#[cfg(target_arch = "x86_64")]
+use simd::{Avx2, Sse2};
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::Arc;
+use std::time::Duration;
+
+/// Maximum number of channels supported. The channel count itself is fixed
+/// when an engine is created, and all state is sized to it.
+pub const AUTOMIX_MAX_CHANNELS: usize = 256;
+
+/// Maximum number of gain-sharing groups. Each group shares gain among its own
+/// channels only, with its own sum and its own NOM.
+pub const AUTOMIX_MAX_GROUPS: usize = 8;
+
+/// Level detector attack time in milliseconds.
+const DETECTOR_ATTACK_MS: f32 = 1.0;
+
+/// Level detector release time in milliseconds.
+const DETECTOR_RELEASE_MS: f32 = 60.0;
+
+/// One-pole smoothing coefficient for a time constant of `ms` milliseconds.
+fn one_pole_coeff(ms: f32, sample_rate: f32) -> f32 {
+    1.0 - (-1.0 / (ms * 0.001 * sample_rate)).exp()
+}
+
+/// Engine configuration for [`AutomixEngine::with_config`].
+#[repr(C)]
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub struct AutomixConfig {
+    pub num_channels: u32,
+    pub sample_rate: f32,
+    pub max_block_size: u32,
+    /// Worker threads that share the per-channel stages with the audio
+    /// thread; 0 processes everything on the calling thread. Capped so every
+    /// thread gets at least one group of 16 channels.
+    pub num_workers: u32,
+    /// Pin worker `i` to CPU `first_cpu + i`; negative leaves them unpinned.
+    pub first_cpu: i32,
+    /// SCHED_FIFO priority for the workers; 0 keeps the default policy.
+    pub realtime_priority: i32,
+    /// How long an idle worker spins before sleeping, in microseconds. Spin
+    /// for at least one block period to keep workers hot between callbacks.
+    pub worker_spin_us: u32,
+    /// Samples between level-detector and gain-share updates; gains ramp
+    /// linearly in between. 0 or 1 updates every sample. Engines with a
+    /// control interval above 1 process on the calling thread only.
+    pub control_interval: u32,
+    /// Compute the share scales from the CPU's reciprocal estimate refined
+    /// by one Newton-Raphson step instead of dividing. Gains then carry a
+    /// relative error of up to 3.1e-5 (about 2e-7 on x86), see
+    /// [`simd::RECIP_MAX_REL_ERROR`].
+    pub fast_reciprocal: bool,
+    /// Time constants in milliseconds with which each channel's gain
+    /// follows its share while rising and while falling. 0 for both applies
+    /// the shares as they are; 0 for one of them makes that direction
+    /// immediate.
+    pub gain_attack_ms: f32,
+    pub gain_release_ms: f32,
+}
+
+impl AutomixConfig {
+    /// Single-threaded configuration.
+    pub fn new(num_channels: usize, sample_rate: f32, max_block_size: usize) -> Self {
+        Self {
+            num_channels: num_channels as u32,
+            sample_rate,
+            max_block_size: max_block_size as u32,
+            num_workers: 0,
+            first_cpu: -1,
+            realtime_priority: 0,
+            worker_spin_us: 0,
+            control_interval: 0,
+            fast_reciprocal: false,
+            gain_attack_ms: 0.0,
+            gain_release_ms: 0.0,
+        }
+    }
+}
+
+/// State that control threads reach while the audio thread holds
+/// `&mut AutomixEngine`; kept behind an `Arc` so the two never alias.
+#[derive(Default)]
+struct Shared {
+    /// Parameter updates waiting for the next `process_raw`.
+    params: ParamQueue,
+    /// Meter snapshots published after every `process_raw`.
+    meters: MeterBus,
+    /// Engine whose learned state is adopted on the next `process_raw`.
+    predecessor: AtomicPtr<AutomixEngine>,
+    /// Engine whose state has been adopted and which is waiting to be freed.
+    retired: AtomicPtr<AutomixEngine>,
+}
+
+/// Core automix engine: Dugan-style gain sharing across all channels.
+///
+/// All working memory is allocated in [`AutomixEngine::new`]; processing
+/// never touches the heap.
 pub struct AutomixEngine {
     num_channels: usize,
     sample_rate: f32,
+    max_block_size: usize,
+    stride: usize,
+    simd: SimdLevel,
+    attack: f32,
+    release: f32,
+    /// Gain smoothing coefficients, 1 for an immediate direction.
+    smooth: bool,
+    gain_attack: f32,
+    gain_release: f32,
+    env: AlignedBuf,
+    noise: NoiseFloor,
+    nom: NomStage,
+    hold: LastMicHold,
+    levels: AlignedBuf,
+    gain: AlignedBuf,
+    /// Weights the kernel shares with, and `LEVEL_FLOOR` times them.
+    share_weight: AlignedBuf,
+    level_floor: AlignedBuf,
+    /// Weights set by the current parameters, which `share_weight` ramps
+    /// towards by `weight_step` per sample for `weight_ramp_left` samples.
+    weight_target: AlignedBuf,
+    weight_step: AlignedBuf,
+    weight_ramp_left: usize,
+    pass_gain: AlignedBuf,
+    /// `AUTOMIX_MAX_GROUPS` rows of per-lane group membership masks.
+    group_masks: AlignedBuf,
+    /// Groups in use, 1..=`AUTOMIX_MAX_GROUPS`.
+    groups: usize,
+    /// Left and right stereo bus gain rows, and the pan gains they ramp
+    /// towards alongside the weights.
+    bus_gain: AlignedBuf,
+    bus_target: AlignedBuf,
+    bus_step: AlignedBuf,
+    /// Samples per control update, 0 in per-sample mode.
+    control_interval: usize,
+    /// Samples since the last control update.
+    control_elapsed: usize,
+    ctrl_peak: AlignedBuf,
+    gain_step: AlignedBuf,
+    tile: AlignedBuf,
+    partials: AlignedBuf,
+    /// Per-participant mix-bus rows of one pool job: two rows of
+    /// `max_block_size` each.
+    bus_partials: AlignedBuf,
+    pool: Option<WorkerPool>,
+    config: AutomixConfig,
+    /// Membership of a cross-engine link; only changed while not processing.
+    link: Option<Arc<Member>>,
+    link_peers: LinkPeers,
+    /// Per-group level the other linked engines published last.
+    remote: [f32; AUTOMIX_MAX_GROUPS],
+    in_peak: AlignedBuf,
+    in_energy: AlignedBuf,
+    out_peak: AlignedBuf,
+    out_energy: AlignedBuf,
+    params: ChannelParams,
+    events: Box<[ParamUpdate]>,
+    meter_sequence: u64,
+    shared: Arc<Shared>,
 }
 
 impl AutomixEngine {
-    pub fn new(num_channels: usize, sample_rate: f32) -> Self {
-        Self {
+    /// Create an engine for `num_channels` inputs, sizing every buffer up
+    /// front. Host blocks longer than `max_block_size` are processed in
+    /// `max_block_size` chunks.
+    pub fn new(num_channels: usize, sample_rate: f32, max_block_size: usize) -> Self {
+        Self::with_config(&AutomixConfig::new(
             num_channels,
             sample_rate,
+            max_block_size,
+        ))
+    }
+
+    /// Create an engine from a full configuration, starting its worker
+    /// threads if it asks for any.
+    pub fn with_config(config: &AutomixConfig) -> Self {
+        let num_channels = (config.num_channels as usize).clamp(1, AUTOMIX_MAX_CHANNELS);
+        let sample_rate = config.sample_rate;
+        let max_block_size = (config.max_block_size as usize).max(1);
+        let stride = padded(num_channels);
+
+        let control_interval = match config.control_interval {
+            0 | 1 => 0,
+            n => n as usize,
+        };
+        let participants = if control_interval > 0 {
+            1
+        } else {
+            (config.num_workers as usize + 1).min(stride / LANE_PAD)
+        };
+        // The detector runs once per control interval in control-rate mode.
+        let detector_rate = sample_rate / control_interval.max(1) as f32;
+        let gain_coeff = |ms: f32| {
+            if ms > 0.0 {
+                one_pole_coeff(ms, detector_rate)
+            } else {
+                1.0
+            }
+        };
+        let pool = (participants > 1).then(|| {
+            WorkerPool::new(PoolOptions {
+                workers: participants - 1,
+                first_cpu: usize::try_from(config.first_cpu).ok(),
+                realtime_priority: config.realtime_priority,
+                spin: Duration::from_micros(config.worker_spin_us.into()),
+            })
+        });
+        let tile_rows = if pool.is_some() {
+            SEGMENT_ROWS
+        } else {
+            TILE_SAMPLES
+        };
+
+        let mut gain = AlignedBuf::zeroed(stride);
+        gain[..num_channels].fill(1.0 / num_channels as f32);
+
+        let mut engine = Self {
+            num_channels,
+            sample_rate,
+            max_block_size,
+            stride,
+            simd: SimdLevel::detect(),
+            attack: one_pole_coeff(DETECTOR_ATTACK_MS, detector_rate),
+            release: one_pole_coeff(DETECTOR_RELEASE_MS, detector_rate),
+            smooth: config.gain_attack_ms > 0.0 || config.gain_release_ms > 0.0,
+            gain_attack: gain_coeff(config.gain_attack_ms),
+            gain_release: gain_coeff(config.gain_release_ms),
+            env: AlignedBuf::zeroed(stride),
+            noise: NoiseFloor::new(stride, sample_rate),
+            nom: NomStage::new(sample_rate),
+            hold: LastMicHold::new(stride, num_channels),
+            levels: AlignedBuf::zeroed(stride * tile_rows),
+            gain,
+            share_weight: AlignedBuf::zeroed(stride),
+            level_floor: AlignedBuf::zeroed(stride),
+            weight_target: AlignedBuf::zeroed(stride),
+            weight_step: AlignedBuf::zeroed(stride),
+            weight_ramp_left: 0,
+            pass_gain: AlignedBuf::zeroed(stride),
+            group_masks: AlignedBuf::zeroed(AUTOMIX_MAX_GROUPS * stride),
+            groups: 1,
+            bus_gain: AlignedBuf::zeroed(2 * stride),
+            bus_target: AlignedBuf::zeroed(2 * stride),
+            bus_step: AlignedBuf::zeroed(2 * stride),
+            control_interval,
+            control_elapsed: 0,
+            ctrl_peak: AlignedBuf::zeroed(stride),
+            gain_step: AlignedBuf::zeroed(stride),
+            tile: AlignedBuf::zeroed(stride * tile_rows),
+            partials: AlignedBuf::zeroed(if pool.is_some() {
+                2 * participants * PARTIALS_PER_PARTICIPANT
+            } else {
+                0
+            }),
+            bus_partials: AlignedBuf::zeroed(if pool.is_some() {
+                participants * 2 * max_block_size
+            } else {
+                0
+            }),
+            pool,
+            link: None,
+            link_peers: LinkPeers::new(sample_rate),
+            remote: [0.0; AUTOMIX_MAX_GROUPS],
+            config: AutomixConfig {
+                num_channels: num_channels as u32,
+                max_block_size: max_block_size as u32,
+                ..*config
+            },
+            in_peak: AlignedBuf::zeroed(stride),
+            in_energy: AlignedBuf::zeroed(stride),
+            out_peak: AlignedBuf::zeroed(stride),
+            out_energy: AlignedBuf::zeroed(stride),
+            params: ChannelParams::new(num_channels),
+            events: vec![ParamUpdate::default(); AUTOMIX_PARAM_QUEUE_CAPACITY].into_boxed_slice(),
+            meter_sequence: 0,
+            shared: Arc::default(),
+        };
+        engine.write_lanes();
+        // Nothing has been mixed yet: start on the initial pans.
+        engine.bus_gain.copy_from_slice(&engine.bus_target);
+        engine.bus_step.fill(0.0);
+        engine
+    }
+
+    /// Build a replacement engine for a new configuration that inherits this
+    /// engine's learned state, threading options and link.
+    ///
+    /// The state is copied on the replacement's first `process_raw` call,
+    /// after which the old engine can be freed with
+    /// [`AutomixEngine::collect_retired`]. Owning the box means nothing is
+    /// processing the old engine; to replace one that the audio thread may
+    /// still be processing, use [`AutomixEngine::replace`].
+    pub fn reconfigure(
+        self: Box<Self>,
+        num_channels: usize,
+        sample_rate: f32,
+        max_block_size: usize,
+    ) -> Box<Self> {
+        let config = AutomixConfig {
+            num_channels: num_channels as u32,
+            sample_rate,
+            max_block_size: max_block_size as u32,
+            ..self.config
+        };
+        let link = self.link.clone();
+        // SAFETY: `self` is ours, so nothing else can be processing it.
+        let mut engine = unsafe { Self::replace(Box::into_raw(self), &config) };
+        if let Some(member) = link {
+            engine.link_peers.watch(&member);
+            engine.link = Some(member);
+        }
+        engine
+    }
+
+    /// Build an engine for `config` that takes over `previous`: it adopts
+    /// its learned state on its first `process_raw` call, on the audio
+    /// thread, and frees it from [`AutomixEngine::collect_retired`].
+    ///
+    /// The replacement starts out unlinked. If it has been linked to the
+    /// link `previous` is in by the time it adopts that state, it takes over
+    /// `previous`'s slot, so the other members keep seeing one engine.
+    ///
+    /// # Safety
+    ///
+    /// `previous` must be null or come from `Box::into_raw`, and must not be
+    /// used by the caller afterwards, except that the audio thread may go
+    /// on processing it until it switches to the replacement. It is not
+    /// dereferenced here.
+    pub unsafe fn replace(previous: *mut Self, config: &AutomixConfig) -> Box<Self> {
+        let engine = Box::new(Self::with_config(config));
+        engine.shared.predecessor.store(previous, Ordering::Release);
+        engine
+    }
+
+    /// Take ownership of the engine this one replaced, once its state has
+    /// been adopted. Safe to call from a control thread while this engine
+    /// is being processed.
+    pub fn collect_retired(&self) -> Option<Box<Self>> {
+        let retired = self.shared.retired.swap(ptr::null_mut(), Ordering::AcqRel);
+        // SAFETY: `retired` came from `Box::into_raw` in `reconfigure` and the
+        // audio thread stopped touching it before publishing it here.
+        (!retired.is_null()).then(|| unsafe { Box::from_raw(retired) })
+    }
+
+    /// Queue a parameter change for the audio thread. Wait-free; call from
+    /// one control thread at a time. Returns `false` if the queue is full.
+    pub fn push_param(&self, update: ParamUpdate) -> bool {
+        self.shared.params.push(update)
+    }
+
+    /// Current parameter values as seen by the audio thread.
+    pub fn params(&self) -> &ChannelParams {
+        &self.params
+    }
+
+    /// Latest meter snapshot, or `None` if no block was processed since the
+    /// last call. Wait-free; call from one reader thread at a time.
+    pub fn read_meters(&self) -> Option<&AutomixMeters> {
+        self.shared.meters.read()
+    }
+
+    /// Adopt the learned state of the engine we replaced, if any.
+    fn adopt_predecessor(&mut self) {
+        let predecessor = self
+            .shared
+            .predecessor
+            .swap(ptr::null_mut(), Ordering::AcqRel);
+        if predecessor.is_null() {
+            return;
+        }
+
+        // SAFETY: the chain is owned by `predecessor`, which only we can reach
+        // now, and no other thread processes engines once they are replaced.
+        self.adopt_chain(unsafe { &mut *predecessor });
+        self.write_lanes();
+
+        self.shared.retired.store(predecessor, Ordering::Release);
+    }
+
+    /// Engines replaced before they ever processed audio still hold their
+    /// own predecessor: the learned state and link slot come from the end of
+    /// that chain, then parameter updates still queued anywhere along it are
+    /// replayed oldest engine first.
+    fn adopt_chain(&mut self, engine: &mut AutomixEngine) {
+        let next = engine.shared.predecessor.load(Ordering::Acquire);
+        if next.is_null() {
+            self.adopt_state(engine);
+            self.adopt_link(engine);
+        } else {
+            // SAFETY: owned by `engine`, see `adopt_predecessor`.
+            self.adopt_chain(unsafe { &mut *next });
+        }
+        while let Some(update) = engine.shared.params.pop() {
+            self.params.apply(&update);
         }
     }
 
+    /// Swap link memberships with `source` if both engines are in the same
+    /// link: this engine carries on in the slot the other members have been
+    /// seeing, and the slot it joined with is released along with `source`.
+    fn adopt_link(&mut self, source: &mut AutomixEngine) {
+        let same = match (&self.link, &source.link) {
+            (Some(own), Some(theirs)) => own.same_link(theirs),
+            _ => false,
+        };
+        if same {
+            std::mem::swap(&mut self.link, &mut source.link);
+            if let Some(member) = &self.link {
+                self.link_peers.watch(member);
+            }
+        }
+    }
+
+    /// Copy per-channel learned state from `source` for the channels both
+    /// engines share.
+    fn adopt_state(&mut self, source: &AutomixEngine) {
+        let shared = self.num_channels.min(source.num_channels);
+        self.env[..shared].copy_from_slice(&source.env[..shared]);
+        self.noise.adopt(&source.noise, shared);
+        self.nom.adopt(&source.nom);
+        self.hold.adopt(&source.hold, shared);
+        self.gain[..shared].copy_from_slice(&source.gain[..shared]);
+        self.share_weight[..shared].copy_from_slice(&source.share_weight[..shared]);
+        self.level_floor[..shared].copy_from_slice(&source.level_floor[..shared]);
+        self.params.copy_from(&source.params);
+        for (row, source_row) in self
+            .bus_gain
+            .chunks_exact_mut(self.stride)
+            .zip(source.bus_gain.chunks_exact(source.stride))
+        {
+            row[..shared].copy_from_slice(&source_row[..shared]);
+        }
+    }
+
+    /// Move queued parameter updates into `events`, sorted by offset.
+    fn drain_params(&mut self) -> usize {
+        let mut count = 0;
+        while count < self.events.len() {
+            match self.shared.params.pop() {
+                Some(update) => {
+                    self.events[count] = update;
+                    count += 1;
+                }
+                None => break,
+            }
+        }
+        params::sort_by_offset(&mut self.events[..count]);
+        count
+    }
+
     pub fn version() -> &'static str {
         env!("CARGO_PKG_VERSION")
     }
 
-    /// Stub process: passes audio through unmodified.
+    pub fn num_channels(&self) -> usize {
+        self.num_channels
+    }
+
+    pub fn sample_rate(&self) -> f32 {
+        self.sample_rate
+    }
+
+    pub fn max_block_size(&self) -> usize {
+        self.max_block_size
+    }
+
+    /// Threads taking part in processing, including the caller's.
+    pub fn num_threads(&self) -> usize {
+        self.pool.as_ref().map_or(1, WorkerPool::participants)
+    }
+
+    /// Instruction set the kernel dispatches to.
+    pub fn simd_level(&self) -> SimdLevel {
+        self.simd
+    }
+
+    /// Force a specific instruction set. Returns `false` and keeps the
+    /// current one if the CPU does not support `level`.
+    pub fn set_simd_level(&mut self, level: SimdLevel) -> bool {
+        if !level.is_supported() {
+            return false;
+        }
+        self.simd = level;
+        true
+    }
+
+    /// Gains applied to the last processed sample, one per channel.
+    pub fn gains(&self) -> &[f32] {
+        &self.gain[..self.num_channels]
+    }
+
+    /// Share gain with every other engine linked under `name`, as if their
+    /// channels were part of this engine. Groups match by index across the
+    /// link. Other engines' levels are taken from their previous block.
+    ///
+    /// Call while the engine is not being processed. Returns false, leaving
+    /// any current link in place, if the link already has
+    /// `AUTOMIX_LINK_SLOTS` members or its shared memory cannot be mapped.
+    pub fn link(&mut self, name: &str, scope: AutomixLinkScope) -> bool {
+        if self.link.as_ref().is_some_and(|m| m.is(name, scope)) {
+            return true;
+        }
+        let Some(member) = Member::join(name, scope) else {
+            return false;
+        };
+        self.link_peers.watch(&member);
+        self.link = Some(member);
+        true
+    }
+
+    /// Leave the current link, if any. Call while the engine is not being
+    /// processed.
+    pub fn unlink(&mut self) {
+        self.link = None;
+        self.remote = [0.0; AUTOMIX_MAX_GROUPS];
+    }
+
+    pub fn is_linked(&self) -> bool {
+        self.link.is_some()
+    }
+
+    /// Apply gain sharing in place to `num_channels` buffers of
+    /// `num_samples` samples each, in the calling thread's floating-point
+    /// mode; wrap the call in a [`denormals::FlushDenormals`] scope unless
+    /// the host already flushes subnormals.
+    ///
+    /// # Safety
+    /// `channel_ptrs` must point to `num_channels` valid, non-aliasing
+    /// buffers of at least `num_samples` floats.
     pub unsafe fn process_raw(
         &mut self,
-        _channel_ptrs: *const *mut f32,
-        _num_channels: usize,
-        _num_samples: usize,
+        channel_ptrs: *const *mut f32,
+        num_channels: usize,
+        num_samples: usize,
     ) {
-        // Phase 0: passthrough — audio buffers are left unmodified
+        self.process_io(
+            Source::Planar(channel_ptrs as *const *const f32),
+            Sink::Planar(channel_ptrs),
+            Bus::None,
+            num_channels,
+            num_samples,
+        )
+    }
+
+    /// Apply gain sharing to `num_samples` samples of `num_channels`
+    /// channels read from `source`, writing the result to `sink` and its
+    /// mix to `bus`. Channels past the engine's channel count are not
+    /// processed, nor written to. Same floating-point mode caveat as
+    /// [`AutomixEngine::process_raw`].
+    ///
+    /// # Safety
+    /// Planar buffers must be `num_channels` valid buffers of at least
+    /// `num_samples` floats, interleaved ones hold `num_samples` frames of
+    /// `num_channels` floats, and bus buffers `num_samples` floats. Output
+    /// buffers must not alias each other, and may alias the input only by
+    /// being the very same buffers.
+    pub unsafe fn process_io(
+        &mut self,
+        source: Source,
+        sink: Sink,
+        bus: Bus,
+        num_channels: usize,
+        num_samples: usize,
+    ) {
+        let _no_alloc = NoAllocScope::enter();
+        self.adopt_predecessor();
+        let io = BlockIo {
+            source,
+            sink,
+            bus,
+            pitch: num_channels,
+            channels: num_channels.min(self.num_channels),
+        };
+
+        self.in_peak.fill(0.0);
+        self.in_energy.fill(0.0);
+        self.out_peak.fill(0.0);
+        self.out_energy.fill(0.0);
+        if let Some(member) = &self.link {
+            self.remote = self.link_peers.remote_sums(member, num_samples);
+        }
+
+        // Split the block at every parameter change so each one lands on
+        // its exact sample. Offsets past the end apply after the block.
+        let num_events = self.drain_params();
+        let mut start = 0;
+        for i in 0..num_events {
+            let event = self.events[i];
+            let at = (event.sample_offset as usize).min(num_samples);
+            if at > start {
+                self.process_span(io, start, at - start);
+                start = at;
+            }
+            self.params.apply(&event);
+            let next_at = self
+                .events
+                .get(i + 1)
+                .map(|e| (e.sample_offset as usize).min(num_samples));
+            if i + 1 == num_events || next_at > Some(start) {
+                self.write_lanes();
+            }
+        }
+        if start < num_samples {
+            self.process_span(io, start, num_samples - start);
+        }
+
+        self.noise.advance(num_samples);
+        self.nom.update(
+            num_samples,
+            &self.env,
+            &self.noise.floor,
+            &self.share_weight,
+            &self.params.group,
+            self.params.nom_depth,
+        );
+        self.hold.update(
+            num_samples,
+            &self.nom,
+            &self.env,
+            &self.params.group,
+            (self.params.hold_ms * 0.001 * self.sample_rate) as u32,
+        );
+        self.publish_meters(num_samples);
+        self.publish_link();
+    }
+
+    /// Publish the level sums the next block of the other linked engines
+    /// will see: each group's sum at the end of this block.
+    fn publish_link(&self) {
+        let Some(member) = &self.link else {
+            return;
+        };
+        let mut sums = [0.0f32; AUTOMIX_MAX_GROUPS];
+        for c in 0..self.num_channels {
+            let env = (self.env[c].max(self.hold.level[c]) - self.noise.floor[c]).max(0.0);
+            let level = env * self.share_weight[c] + self.level_floor[c];
+            sums[self.params.group[c] as usize] += level;
+        }
+        member.publish(&sums);
+    }
+
+    /// Turn the block's meter accumulators into a snapshot for the editor.
+    fn publish_meters(&mut self, num_samples: usize) {
+        self.meter_sequence += 1;
+        let sequence = self.meter_sequence;
+        let channels = self.num_channels;
+        let inv_len = 1.0 / num_samples.max(1) as f32;
+
+        // Effective number of open mics per group: (sum g)^2 / sum g^2 over
+        // the channels taking part in the share. One talker gives 1, N equal
+        // talkers give N.
+        let groups = self.groups;
+        let mut sum = [0.0f32; AUTOMIX_MAX_GROUPS];
+        let mut sum_sq = [0.0f32; AUTOMIX_MAX_GROUPS];
+        for c in 0..channels {
+            if self.share_weight[c] > 0.0 {
+                let g = self.params.group[c] as usize;
+                sum[g] += self.gain[c];
+                sum_sq[g] += self.gain[c] * self.gain[c];
+            }
+        }
+        let mut group_nom = [0.0f32; AUTOMIX_MAX_GROUPS];
+        for g in 0..groups {
+            if sum_sq[g] > 0.0 {
+                group_nom[g] = sum[g] * sum[g] / sum_sq[g];
+            }
+        }
+        let nom = group_nom.iter().sum();
+        let group_open_mics = self.nom.count;
+        let mut group_nom_gain = [0.0f32; AUTOMIX_MAX_GROUPS];
+        group_nom_gain[..groups].copy_from_slice(&self.nom.ramp.gain[..groups]);
+
+        self.shared.meters.publish(|m| {
+            m.sequence = sequence;
+            m.num_channels = channels as u32;
+            m.nom = nom;
+            m.num_groups = groups as u32;
+            m.group_nom = group_nom;
+            m.open_mics = group_open_mics.iter().sum();
+            m.group_open_mics = group_open_mics;
+            m.group_nom_gain = group_nom_gain;
+            for c in 0..channels {
+                m.channels[c] = AutomixChannelMeter {
+                    input_peak: self.in_peak[c],
+                    input_rms: (self.in_energy[c] * inv_len).sqrt(),
+                    gain: self.gain[c],
+                    output_peak: self.out_peak[c],
+                    output_rms: (self.out_energy[c] * inv_len).sqrt(),
+                };
+            }
+        });
+    }
+
+    /// Refresh the kernel's per-lane arrays from the current parameters.
+    ///
+    /// A changed weight ramps in linearly over `max_block_size` samples so
+    /// the gains do not step. Channels joining or leaving the share (a weight
+    /// to or from zero, as the solo/mute/bypass switches do) switch at once.
+    fn write_lanes(&mut self) {
+        self.groups = self.params.write_lanes(
+            &mut self.weight_target,
+            &mut self.pass_gain,
+            &mut self.group_masks,
+            &mut self.bus_target,
+        );
+
+        let ramp = self.max_block_size as f32;
+        let mut ramping = false;
+        for j in 0..self.stride {
+            let (from, to) = (self.share_weight[j], self.weight_target[j]);
+            if from != to && from > 0.0 && to > 0.0 {
+                self.weight_step[j] = (to - from) / ramp;
+                ramping = true;
+            } else {
+                self.weight_step[j] = 0.0;
+                self.share_weight[j] = to;
+                self.level_floor[j] = to * LEVEL_FLOOR;
+            }
+        }
+        // Pans always ramp, so automating them never steps the bus.
+        for j in 0..2 * self.stride {
+            let (from, to) = (self.bus_gain[j], self.bus_target[j]);
+            self.bus_step[j] = (to - from) / ramp;
+            ramping |= from != to;
+        }
+        self.weight_ramp_left = if ramping { self.max_block_size } else { 0 };
+    }
+
+    /// Land every weight and bus gain exactly on its target once the ramp
+    /// is over.
+    fn finish_weight_ramp(&mut self) {
+        self.share_weight.copy_from_slice(&self.weight_target);
+        for (floor, &weight) in self.level_floor.iter_mut().zip(self.weight_target.iter()) {
+            *floor = weight * LEVEL_FLOOR;
+        }
+        self.weight_step.fill(0.0);
+        self.bus_gain.copy_from_slice(&self.bus_target);
+        self.bus_step.fill(0.0);
+    }
+
+    /// Step the bus gains along a ramp over `len` samples the kernel
+    /// processed without a stereo bus, which leaves them alone.
+    fn step_bus_ramp(&mut self, len: usize) {
+        let len = len as f32;
+        for (gain, &step) in self.bus_gain.iter_mut().zip(self.bus_step.iter()) {
+            *gain = step.mul_add(len, *gain);
+        }
+    }
+
+    /// Kernel view of the whole engine state.
+    fn share(&mut self) -> Share {
+        Share {
+            stride: self.stride,
+            lanes: self.stride,
+            env: self.env.as_mut_ptr(),
+            noise_min: self.noise.min.as_mut_ptr(),
+            noise_floor: self.noise.floor.as_ptr(),
+            hold: self.hold.level.as_ptr(),
+            gain: self.gain.as_mut_ptr(),
+            share_weight: self.share_weight.as_mut_ptr(),
+            level_floor: self.level_floor.as_mut_ptr(),
+            weight_step: self.weight_step.as_ptr(),
+            ramp_weights: self.weight_ramp_left > 0,
+            pass_gain: self.pass_gain.as_ptr(),
+            in_peak: self.in_peak.as_mut_ptr(),
+            in_energy: self.in_energy.as_mut_ptr(),
+            out_peak: self.out_peak.as_mut_ptr(),
+            out_energy: self.out_energy.as_mut_ptr(),
+            attack: self.attack,
+            release: self.release,
+            smooth: self.smooth,
+            gain_attack: self.gain_attack,
+            gain_release: self.gain_release,
+            groups: self.groups,
+            group_masks: self.group_masks.as_ptr(),
+            bus_gain: self.bus_gain.as_mut_ptr(),
+            bus_step: self.bus_step.as_ptr(),
+            ctrl_peak: self.ctrl_peak.as_mut_ptr(),
+            gain_step: self.gain_step.as_mut_ptr(),
+            remote: self.remote,
+            fast_recip: self.config.fast_reciprocal,
+            nom: self.nom.ramp,
+        }
+    }
+
+    /// Process `len` samples starting at `start`, split where a weight ramp
+    /// ends so the kernel only carries the ramp while one is running.
+    unsafe fn process_span(&mut self, io: BlockIo, mut start: usize, mut len: usize) {
+        while self.weight_ramp_left > 0 && len > 0 {
+            let n = len.min(self.weight_ramp_left);
+            self.dispatch_span(io, start, n);
+            if !matches!(io.bus, Bus::Stereo(..)) {
+                self.step_bus_ramp(n);
+            }
+            self.weight_ramp_left -= n;
+            if self.weight_ramp_left == 0 {
+                self.finish_weight_ramp();
+            }
+            start += n;
+            len -= n;
+        }
+        if len > 0 {
+            self.dispatch_span(io, start, len);
+        }
+    }
+
+    /// Dispatch `len` samples starting at `start` to the best kernel.
+    unsafe fn dispatch_span(&mut self, io: BlockIo, start: usize, len: usize) {
+        if self.pool.is_some() {
+            return self.process_parallel(io, start, len);
+        }
+        match self.simd {
+            #[cfg(target_arch = "x86_64")]
+            SimdLevel::Avx2 => self.process_avx2(io, start, len),
+            #[cfg(target_arch = "x86_64")]
+            SimdLevel::Sse2 => self.process_block::<Sse2>(io, start, len),
+            #[cfg(target_arch = "aarch64")]
+            SimdLevel::Neon => self.process_block::<Neon>(io, start, len),
+            _ => self.process_block::<f32>(io, start, len),
+        }
+    }
+
+    /// Split `len` samples starting at `start` across the worker pool.
+    unsafe fn process_parallel(&mut self, io: BlockIo, start: usize, len: usize) {
+        let run: JobFn = match self.simd {
+            #[cfg(target_arch = "x86_64")]
+            SimdLevel::Avx2 => parallel::run_avx2,
+            #[cfg(target_arch = "x86_64")]
+            SimdLevel::Sse2 => parallel::run::<Sse2>,
+            #[cfg(target_arch = "aarch64")]
+            SimdLevel::Neon => parallel::run::<Neon>,
+            _ => parallel::run::<f32>,
+        };
+        // Chunks fit the bus partials.
+        let end = start + len;
+        let mut offset = start;
+        while offset < end {
+            let len = (end - offset).min(self.max_block_size);
+            let job = ParallelSpan {
+                share: self.share(),
+                tile: self.tile.as_mut_ptr(),
+                levels: self.levels.as_mut_ptr(),
+                partials: self.partials.as_mut_ptr(),
+                bus_partials: self.bus_partials.as_mut_ptr(),
+                bus_len: self.max_block_size,
+                participants: self.num_threads(),
+                io,
+                start: offset,
+                len,
+            };
+            if let Some(pool) = &self.pool {
+                pool.run(&job as *const ParallelSpan as *const (), run);
+            }
+            self.sum_bus_partials(io.bus_rows(offset), len);
+            offset += len;
+        }
+    }
+
+    /// Add up the participants' mix-bus rows of the last pool job, `len`
+    /// rows each, into `bus`.
+    unsafe fn sum_bus_partials(&self, bus: BusRows, len: usize) {
+        let rows = self.max_block_size;
+        for (b, &row) in bus.rows.iter().enumerate().take(bus.channels) {
+            let out = std::slice::from_raw_parts_mut(row, len);
+            out.copy_from_slice(&self.bus_partials[b * rows..][..len]);
+            for p in 1..self.num_threads() {
+                let partial = &self.bus_partials[(p * 2 + b) * rows..][..len];
+                for (out, &x) in out.iter_mut().zip(partial) {
+                    *out += x;
+                }
+            }
+        }
+    }
+
+    #[cfg(target_arch = "x86_64")]
+    #[target_feature(enable = "avx2,fma")]
+    unsafe fn process_avx2(&mut self, io: BlockIo, start: usize, len: usize) {
+        self.process_block::<Avx2>(io, start, len)
+    }
+
+    #[inline(always)]
+    unsafe fn process_block<V: F32s>(&mut self, io: BlockIo, start: usize, len: usize) {
+        let end = start + len;
+        let mut offset = start;
+        while offset < end {
+            let len = (end - offset).min(self.max_block_size);
+            self.process_chunk::<V>(io, offset, len);
+            offset += len;
+        }
+    }
+
+    #[inline(always)]
+    unsafe fn process_chunk<V: F32s>(&mut self, io: BlockIo, start: usize, len: usize) {
+        if self.control_interval > 0 {
+            return self.process_chunk_control::<V>(io, start, len);
+        }
+        let share = self.share();
+        let tile = self.tile.as_mut_ptr();
+        let levels = self.levels.as_mut_ptr();
+
+        let stride = self.stride;
+
+        let mut offset = start;
+        while offset < start + len {
+            let rows = (start + len - offset).min(TILE_SAMPLES);
+            io.load::<V>(tile, stride, 0, stride, offset, rows);
+            let src = io.source::<V>(tile, stride, 0, offset);
+            let dst = io.target::<V>(tile, stride, 0, offset);
+            let bus = io.bus_rows(offset);
+            kernel::share_rows::<V>(&share, src, dst, levels, rows, offset, bus);
+            io.store::<V>(tile, stride, 0, stride, offset, rows);
+            offset += rows;
+        }
+    }
+
+    /// Control-rate counterpart of `process_chunk`. Tiles are cut at control
+    /// interval boundaries, so every update sees exactly one interval and
+    /// every ramp spans exactly one.
+    #[inline(always)]
+    unsafe fn process_chunk_control<V: F32s>(&mut self, io: BlockIo, start: usize, len: usize) {
+        let share = self.share();
+        let tile = self.tile.as_mut_ptr();
+        let levels = self.levels.as_mut_ptr();
+        let interval = self.control_interval;
+        let stride = self.stride;
+
+        let mut offset = start;
+        while offset < start + len {
+            let rows = (start + len - offset)
+                .min(TILE_SAMPLES)
+                .min(interval - self.control_elapsed);
+            io.load::<V>(tile, stride, 0, stride, offset, rows);
+            let src = io.source::<V>(tile, stride, 0, offset);
+            let dst = io.target::<V>(tile, stride, 0, offset);
+            kernel::ramp_rows::<V>(&share, src, dst, rows, io.bus_rows(offset));
+            if share.ramp_weights {
+                kernel::ramp_weights::<V>(&share, rows);
+            }
+            io.store::<V>(tile, stride, 0, stride, offset, rows);
+            self.control_elapsed += rows;
+            if self.control_elapsed == interval {
+                self.control_elapsed = 0;
+                kernel::control_update::<V>(&share, levels, interval, offset + rows);
+            }
+            offset += rows;
+        }
+    }
+}
+
+impl Drop for AutomixEngine {
+    fn drop(&mut self) {
+        for slot in [&self.shared.predecessor, &self.shared.retired] {
+            let engine = slot.swap(ptr::null_mut(), Ordering::AcqRel);
+            if !engine.is_null() {
+                // SAFETY: slots only ever hold pointers from `Box::into_raw`.
+                drop(unsafe { Box::from_raw(engine) });
+            }
+        }
     }
 }
 
 #[cfg(test)]
 mod tests {
     use super::*;
+    use params::{AutomixParam, AUTOMIX_MAX_WEIGHT};
+
+    /// Deterministic pseudo-random samples in [-1, 1).
+    fn noise(seed: &mut u32) -> f32 {
+        *seed = seed.wrapping_mul(1_664_525).wrapping_add(1_013_904_223);
+        (*seed >> 8) as f32 / (1u32 << 23) as f32 - 1.0
+    }
+
+    fn run(engine: &mut AutomixEngine, buffers: &mut [Vec<f32>]) {
+        let ptrs: Vec<*mut f32> = buffers.iter_mut().map(|b| b.as_mut_ptr()).collect();
+        unsafe { engine.process_raw(ptrs.as_ptr(), ptrs.len(), buffers[0].len()) };
+    }
 
     #[test]
     fn test_engine_creation() {
-        let engine = AutomixEngine::new(8, 48000.0);
+        let engine = AutomixEngine::new(8, 48000.0, 512);
         assert_eq!(engine.num_channels, 8);
         assert_eq!(engine.sample_rate, 48000.0);
+        assert_eq!(engine.max_block_size, 512);
     }
 
     #[test]
@@ -48,4 +1021,1107 @@ mod tests {
         let version = AutomixEngine::version();
         assert_eq!(version, "0.1.0");
     }
+
+    #[test]
+    fn test_silence_shares_gain_equally() {
+        let mut engine = AutomixEngine::new(4, 48000.0, 256);
+        let mut buffers = vec![vec![0.0f32; 256]; 4];
+        run(&mut engine, &mut buffers);
+        for &g in engine.gains() {
+            assert!((g - 0.25).abs() < 1e-6);
+        }
+        assert!(buffers.iter().flatten().all(|&s| s == 0.0));
+    }
+
+    #[test]
+    fn test_active_channel_takes_the_gain() {
+        let mut engine = AutomixEngine::new(8, 48000.0, 512);
+        let mut seed = 1;
+        let mut buffers = vec![vec![0.0f32; 4800]; 8];
+        for s in buffers[3].iter_mut() {
+            *s = 0.5 * noise(&mut seed);
+        }
+        run(&mut engine, &mut buffers);
+        let gains = engine.gains();
+        assert!(gains[3] > 0.99, "talker gain {}", gains[3]);
+        for (c, &g) in gains.iter().enumerate() {
+            if c != 3 {
+                assert!(g < 1e-3, "channel {c} gain {g}");
+            }
+        }
+    }
+
+    #[test]
+    fn test_gains_sum_to_unity() {
+        let mut engine = AutomixEngine::new(32, 96000.0, 333);
+        let mut seed = 7;
+        let mut buffers: Vec<Vec<f32>> = (0..32)
+            .map(|c| {
+                (0..333)
+                    .map(|_| noise(&mut seed) * (c as f32 / 32.0))
+                    .collect()
+            })
+            .collect();
+        for _ in 0..4 {
+            run(&mut engine, &mut buffers);
+            let total: f32 = engine.gains().iter().sum();
+            assert!((total - 1.0).abs() < 1e-4, "total gain {total}");
+        }
+    }
+
+    #[test]
+    fn test_channel_count_up_to_the_limit() {
+        let engine = AutomixEngine::new(AUTOMIX_MAX_CHANNELS + 1, 48000.0, 64);
+        assert_eq!(engine.num_channels(), AUTOMIX_MAX_CHANNELS);
+
+        let mut engine = AutomixEngine::new(200, 48000.0, 64);
+        let mut seed = 5;
+        let mut buffers: Vec<Vec<f32>> = (0..200)
+            .map(|c| {
+                let scale = if c == 137 { 0.5 } else { 1e-4 };
+                (0..4800).map(|_| noise(&mut seed) * scale).collect()
+            })
+            .collect();
+        run(&mut engine, &mut buffers);
+        let total: f32 = engine.gains().iter().sum();
+        assert!((total - 1.0).abs() < 1e-4, "total gain {total}");
+        assert!(
+            engine.gains()[137] > 0.8,
+            "talker gain {}",
+            engine.gains()[137]
+        );
+    }
+
+    #[test]
+    fn test_long_blocks_are_chunked() {
+        let mut seed = 3;
+        let input: Vec<Vec<f32>> = (0..6)
+            .map(|_| (0..1000).map(|_| noise(&mut seed)).collect())
+            .collect();
+
+        let mut whole = AutomixEngine::new(6, 48000.0, 64);
+        let mut a = input.clone();
+        run(&mut whole, &mut a);
+
+        let mut split = AutomixEngine::new(6, 48000.0, 1000);
+        let mut b = input;
+        for start in (0..1000).step_by(64) {
+            let len = (1000 - start).min(64);
+            let ptrs: Vec<*mut f32> = b
+                .iter_mut()
+                .map(|ch| unsafe { ch.as_mut_ptr().add(start) })
+                .collect();
+            unsafe { split.process_raw(ptrs.as_ptr(), 6, len) };
+        }
+        assert_eq!(a, b);
+    }
+
+    #[test]
+    fn test_meter_accumulators_cover_the_block() {
+        let mut engine = AutomixEngine::new(2, 48000.0, 128);
+        let mut buffers = vec![vec![0.5f32; 128], vec![-0.25f32; 128]];
+        run(&mut engine, &mut buffers);
+        assert_eq!(engine.in_peak[0], 0.5);
+        assert_eq!(engine.in_peak[1], 0.25);
+        assert!((engine.in_energy[0] - 128.0 * 0.25).abs() < 1e-3);
+        assert!(engine.out_peak[0] <= 0.5 && engine.out_peak[0] > 0.25);
+    }
+
+    #[test]
+    fn test_reconfigure_keeps_learned_state() {
+        let mut engine = Box::new(AutomixEngine::new(4, 48000.0, 256));
+        let mut seed = 11;
+        let mut buffers = vec![vec![0.0f32; 2400]; 4];
+        for s in buffers[1].iter_mut() {
+            *s = noise(&mut seed);
+        }
+        run(&mut engine, &mut buffers);
+        let learned = engine.gains().to_vec();
+
+        // Replace twice before the audio thread gets to run: the state must
+        // still come from the engine that actually processed audio.
+        let engine = engine.reconfigure(6, 96000.0, 32);
+        let mut engine = engine.reconfigure(6, 96000.0, 64);
+        assert!(engine.collect_retired().is_none());
+
+        let mut silence = vec![vec![0.0f32; 1]; 6];
+        run(&mut engine, &mut silence);
+        assert!(engine.gains()[1] > 0.99 * learned[1]);
+        assert!(engine.gains()[4] < 1e-3);
+
+        assert!(engine.collect_retired().is_some());
+        assert!(engine.collect_retired().is_none());
+    }
+
+    fn set(engine: &AutomixEngine, param: AutomixParam, channel: u32, value: f32, offset: u32) {
+        assert!(engine.push_param(ParamUpdate {
+            param,
+            channel,
+            value,
+            sample_offset: offset,
+        }));
+    }
+
+    #[test]
+    fn test_param_changes_are_sample_accurate() {
+        let mut engine = AutomixEngine::new(2, 48000.0, 64);
+        set(&engine, AutomixParam::Mute, 0, 1.0, 37);
+        let mut buffers = vec![vec![0.5f32; 64], vec![0.0f32; 64]];
+        run(&mut engine, &mut buffers);
+        assert!(buffers[0][..37].iter().all(|&s| s > 0.0));
+        assert!(buffers[0][37..].iter().all(|&s| s == 0.0));
+        assert!(engine.params().mute[0]);
+    }
+
+    #[test]
+    fn test_bypass_passes_at_unity_outside_the_share() {
+        let mut engine = AutomixEngine::new(3, 48000.0, 256);
+        set(&engine, AutomixParam::Bypass, 2, 1.0, 0);
+        let mut buffers = vec![vec![0.0f32; 256], vec![0.0f32; 256], vec![0.3f32; 256]];
+        run(&mut engine, &mut buffers);
+        assert!(buffers[2].iter().all(|&s| s == 0.3));
+        assert_eq!(engine.gains(), [0.5, 0.5, 1.0]);
+    }
+
+    #[test]
+    fn test_weight_biases_the_share() {
+        let mut engine = AutomixEngine::new(2, 48000.0, 256);
+        set(&engine, AutomixParam::Weight, 0, 3.0, 0);
+        set(&engine, AutomixParam::HoldTime, 0, 250.0, 0);
+        let mut buffers = vec![vec![0.0f32; 256]; 2];
+        run(&mut engine, &mut buffers);
+        assert!((engine.gains()[0] - 0.75).abs() < 1e-6);
+        assert_eq!(engine.params().hold_ms, 250.0);
+    }
+
+    #[test]
+    fn test_non_finite_and_huge_weights_keep_gains_finite() {
+        let mut engine = AutomixEngine::new(4, 48000.0, 256);
+        set(&engine, AutomixParam::Weight, 0, f32::INFINITY, 0);
+        set(&engine, AutomixParam::Weight, 1, f32::NAN, 0);
+        set(&engine, AutomixParam::Weight, 2, f32::MAX, 0);
+        set(&engine, AutomixParam::Weight, 3, 1.0e30, 0);
+        let mut seed = 11;
+        for _ in 0..8 {
+            let mut buffers: Vec<Vec<f32>> = (0..4)
+                .map(|_| (0..256).map(|_| noise(&mut seed) * 0.9).collect())
+                .collect();
+            run(&mut engine, &mut buffers);
+            assert!(buffers.iter().flatten().all(|x| x.is_finite()));
+            let gains = engine.gains();
+            assert!(gains.iter().all(|g| g.is_finite()), "{gains:?}");
+            let total: f32 = gains.iter().sum();
+            assert!((total - 1.0).abs() < 1e-4, "total gain {total}");
+        }
+        let weight = &engine.params().weight;
+        assert_eq!(
+            weight[..],
+            [1.0, 1.0, AUTOMIX_MAX_WEIGHT, AUTOMIX_MAX_WEIGHT]
+        );
+    }
+
+    #[test]
+    fn test_weight_changes_ramp_without_steps() {
+        for (workers, interval) in [(0, 0), (3, 0), (0, 16)] {
+            let mut engine = AutomixEngine::with_config(&AutomixConfig {
+                num_workers: workers,
+                control_interval: interval,
+                ..AutomixConfig::new(64, 48000.0, 256)
+            });
+            let mut output = Vec::new();
+            for block in 0..8 {
+                if block == 4 {
+                    set(&engine, AutomixParam::Weight, 0, 3.0, 100);
+                }
+                let mut buffers = vec![vec![0.5f32; 256]; 64];
+                run(&mut engine, &mut buffers);
+                output.extend_from_slice(&buffers[0]);
+            }
+
+            // Channel 0's gain moves from 1/64 to 3/66 over one block, in
+            // steps far below the jump an instant change would make.
+            let gains: Vec<f32> = output.iter().map(|y| y / 0.5).collect();
+            assert!((gains[4 * 256 + 99] - 1.0 / 64.0).abs() < 1e-4);
+            for (i, pair) in gains[3 * 256..].windows(2).enumerate() {
+                let step = (pair[1] - pair[0]).abs();
+                assert!(step < 0.001, "{workers}/{interval} sample {i}: {step}");
+            }
+            let last = *gains.last().unwrap();
+            assert!(
+                (last - 3.0 / 66.0).abs() < 1e-4,
+                "{workers}/{interval}: {last}"
+            );
+        }
+    }
+
+    #[test]
+    fn test_gains_follow_shares_through_attack_release_smoothing() {
+        // The detectors do not depend on the gains, so a smoothed engine's
+        // gains are the unsmoothed engine's run through the one-pole
+        // filter, at the rate the gains are computed at.
+        for (workers, interval) in [(0, 0), (3, 0), (0, 16)] {
+            let config = AutomixConfig {
+                num_workers: workers,
+                control_interval: interval,
+                ..AutomixConfig::new(64, 48000.0, 256)
+            };
+            let mut raw = AutomixEngine::with_config(&config);
+            let mut smoothed = AutomixEngine::with_config(&AutomixConfig {
+                gain_attack_ms: 2.0,
+                gain_release_ms: 20.0,
+                ..config
+            });
+            let rate = 48000.0 / interval.max(1) as f32;
+            let attack = one_pole_coeff(2.0, rate);
+            let release = one_pole_coeff(20.0, rate);
+            let block = interval.max(1) as usize;
+
+            let mut expected: Vec<f32> = raw.gains().to_vec();
+            let mut seed = 31;
+            let mut moved = 0.0f32;
+            for s in (0..4800).step_by(block) {
+                let talker = s / 1200 % 2;
+                let input: Vec<Vec<f32>> = (0..64)
+                    .map(|c| {
+                        let scale = if c == talker { 0.3 } else { 0.002 };
+                        (0..block).map(|_| noise(&mut seed) * scale).collect()
+                    })
+                    .collect();
+                run(&mut raw, &mut input.clone());
+                run(&mut smoothed, &mut input.clone());
+
+                for (c, (y, &x)) in expected.iter_mut().zip(raw.gains()).enumerate() {
+                    *y += (x - *y) * if x > *y { attack } else { release };
+                    let gain = smoothed.gains()[c];
+                    assert!(
+                        (gain - *y).abs() < 1e-5,
+                        "{workers}/{interval} sample {s} channel {c}: {gain} vs {y}"
+                    );
+                    moved = moved.max((gain - x).abs());
+                }
+            }
+            assert!(moved > 0.1, "{workers}/{interval}: {moved}");
+        }
+    }
+
+    #[test]
+    fn test_interleaved_io_matches_planar() {
+        // Channel counts that fill whole lane groups are read in place when
+        // aligned; a misaligned buffer or a partial group goes through the
+        // tile. Every block switches between interleaved output in place,
+        // interleaved output to another buffer and planar output.
+        for (channels, workers, interval, misalign) in [
+            (32, 0, 0, 0),
+            (32, 0, 0, 1),
+            (5, 0, 0, 0),
+            (64, 3, 0, 0),
+            (64, 3, 0, 1),
+            (32, 0, 16, 0),
+        ] {
+            let config = AutomixConfig {
+                num_workers: workers,
+                control_interval: interval,
+                ..AutomixConfig::new(channels, 48000.0, 256)
+            };
+            let mut planar = AutomixEngine::with_config(&config);
+            let mut interleaved = AutomixEngine::with_config(&config);
+            let frames = 200;
+            let mut input = AlignedBuf::zeroed(channels * frames + 16);
+            let mut output = AlignedBuf::zeroed(channels * frames + 16);
+            let mut seed = 37;
+            for block in 0..12 {
+                let talker = block / 3 % channels;
+                let mut expected: Vec<Vec<f32>> = (0..channels)
+                    .map(|c| {
+                        let scale = if c == talker { 0.3 } else { 0.002 };
+                        (0..frames).map(|_| noise(&mut seed) * scale).collect()
+                    })
+                    .collect();
+                let frame = &mut input[misalign..][..channels * frames];
+                for (c, samples) in expected.iter().enumerate() {
+                    for (s, &x) in samples.iter().enumerate() {
+                        frame[s * channels + c] = x;
+                    }
+                }
+                run(&mut planar, &mut expected);
+
+                let mut outputs = vec![vec![0.0f32; frames]; channels];
+                let ptrs: Vec<*mut f32> = outputs.iter_mut().map(|b| b.as_mut_ptr()).collect();
+                let src = input[misalign..].as_mut_ptr();
+                let (sink, result) = match block % 3 {
+                    0 => (Sink::Interleaved(src), src as *const f32),
+                    1 => {
+                        let dst = output[misalign..].as_mut_ptr();
+                        (Sink::Interleaved(dst), dst as *const f32)
+                    }
+                    _ => (Sink::Planar(ptrs.as_ptr()), ptr::null()),
+                };
+                unsafe {
+                    interleaved.process_io(
+                        Source::Interleaved(src),
+                        sink,
+                        Bus::None,
+                        channels,
+                        frames,
+                    );
+                }
+
+                for (c, samples) in expected.iter().enumerate() {
+                    for (s, &x) in samples.iter().enumerate() {
+                        let y = if result.is_null() {
+                            outputs[c][s]
+                        } else {
+                            unsafe { *result.add(s * channels + c) }
+                        };
+                        assert_eq!(
+                            x, y,
+                            "{channels}/{workers}/{interval}/{misalign} block {block}"
+                        );
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_out_of_place_output_and_mix_bus() {
+        // Blocks of 300 samples are longer than the engines' 256, so the
+        // pool runs two jobs per block and adds up the bus of each.
+        let pans = [-1.0, 1.0, 0.5];
+        for (channels, workers, interval) in [(5, 0, 0), (64, 3, 0), (32, 0, 16)] {
+            let config = AutomixConfig {
+                num_workers: workers,
+                control_interval: interval,
+                ..AutomixConfig::new(channels, 48000.0, 256)
+            };
+            let mut in_place = AutomixEngine::with_config(&config);
+            let mut engine = AutomixEngine::with_config(&config);
+            for (c, &pan) in pans.iter().enumerate() {
+                set(&engine, AutomixParam::Pan, c as u32, pan, 0);
+            }
+            let pan_gain = |c: usize| {
+                let angle =
+                    (pans.get(c).copied().unwrap_or(0.0) + 1.0) * std::f32::consts::FRAC_PI_4;
+                [angle.cos(), angle.sin()]
+            };
+
+            let frames = 300;
+            let mut seed = 41;
+            for block in 0..8 {
+                let talker = block / 2 % channels;
+                let input: Vec<Vec<f32>> = (0..channels)
+                    .map(|c| {
+                        let scale = if c == talker { 0.3 } else { 0.002 };
+                        (0..frames).map(|_| noise(&mut seed) * scale).collect()
+                    })
+                    .collect();
+                let mut expected = input.clone();
+                run(&mut in_place, &mut expected);
+
+                let mut outputs = vec![vec![0.0f32; frames]; channels];
+                let mut mix = vec![vec![0.0f32; frames]; 2];
+                let input_ptrs: Vec<*const f32> = input.iter().map(|b| b.as_ptr()).collect();
+                let output_ptrs: Vec<*mut f32> =
+                    outputs.iter_mut().map(|b| b.as_mut_ptr()).collect();
+                let stereo = block % 2 == 1;
+                let bus = if stereo {
+                    Bus::Stereo(mix[0].as_mut_ptr(), mix[1].as_mut_ptr())
+                } else {
+                    Bus::Mono(mix[0].as_mut_ptr())
+                };
+                unsafe {
+                    engine.process_io(
+                        Source::Planar(input_ptrs.as_ptr()),
+                        Sink::Planar(output_ptrs.as_ptr()),
+                        bus,
+                        channels,
+                        frames,
+                    );
+                }
+
+                let case = format!("{channels}/{workers}/{interval} block {block}");
+                assert_eq!(outputs, expected, "{case}");
+                for s in 0..frames {
+                    let (mut sums, mut scale) = ([0.0f32; 2], 0.0f32);
+                    for (c, output) in outputs.iter().enumerate() {
+                        let gain = if stereo { pan_gain(c) } else { [1.0, 0.0] };
+                        sums[0] += output[s] * gain[0];
+                        sums[1] += output[s] * gain[1];
+                        scale += output[s].abs();
+                    }
+                    for b in 0..1 + stereo as usize {
+                        let error = (mix[b][s] - sums[b]).abs();
+                        assert!(error <= scale * 1e-6, "{case} bus {b} sample {s}: {error}");
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_pan_changes_glide_on_the_stereo_bus() {
+        for (channels, workers, interval) in [(2, 0, 0), (64, 3, 0), (2, 0, 16)] {
+            let config = AutomixConfig {
+                num_workers: workers,
+                control_interval: interval,
+                ..AutomixConfig::new(channels, 48000.0, 256)
+            };
+            let mut engine = AutomixEngine::with_config(&config);
+            // Channel 0 passes at unity, all others are silent.
+            set(&engine, AutomixParam::Bypass, 0, 1.0, 0);
+            for c in 1..channels as u32 {
+                set(&engine, AutomixParam::Mute, c, 1.0, 0);
+            }
+            let block = |engine: &mut AutomixEngine, stereo: bool| {
+                let input = vec![vec![0.5f32; 200]; channels];
+                let mut output = input.clone();
+                let mut mix = [vec![0.0f32; 200], vec![0.0f32; 200]];
+                let input_ptrs: Vec<*const f32> = input.iter().map(|b| b.as_ptr()).collect();
+                let output_ptrs: Vec<*mut f32> =
+                    output.iter_mut().map(|b| b.as_mut_ptr()).collect();
+                let bus = if stereo {
+                    Bus::Stereo(mix[0].as_mut_ptr(), mix[1].as_mut_ptr())
+                } else {
+                    Bus::Mono(mix[0].as_mut_ptr())
+                };
+                unsafe {
+                    engine.process_io(
+                        Source::Planar(input_ptrs.as_ptr()),
+                        Sink::Planar(output_ptrs.as_ptr()),
+                        bus,
+                        channels,
+                        200,
+                    );
+                }
+                mix
+            };
+            let center = 0.5 * std::f32::consts::FRAC_1_SQRT_2;
+            let case = format!("{channels}/{workers}/{interval}");
+            assert!(
+                (block(&mut engine, true)[0][199] - center).abs() < 1e-6,
+                "{case}"
+            );
+
+            // Hard right from sample 100 on: the left bus glides down over
+            // the 256-sample ramp instead of dropping to zero.
+            set(&engine, AutomixParam::Pan, 0, 1.0, 100);
+            let mut left = block(&mut engine, true)[0].clone();
+            left.extend_from_slice(&block(&mut engine, true)[0]);
+            assert!((left[99] - center).abs() < 1e-6, "{case}");
+            for pair in left[99..].windows(2) {
+                assert!(
+                    pair[1] <= pair[0] + 1e-6 && pair[0] - pair[1] < 0.002,
+                    "{case}"
+                );
+            }
+            assert!(left[200] > 0.1 && left[355].abs() < 1e-6, "{case}");
+
+            // Non-finite pans are ignored, and a ramp runs on through blocks
+            // mixed without a stereo bus.
+            set(&engine, AutomixParam::Pan, 0, f32::NAN, 0);
+            assert!(
+                block(&mut engine, true)[0].iter().all(|&x| x.abs() < 1e-6),
+                "{case}"
+            );
+            set(&engine, AutomixParam::Pan, 0, -1.0, 0);
+            block(&mut engine, false);
+            let left = block(&mut engine, true)[0].clone();
+            assert!(left[..55].windows(2).all(|p| p[1] > p[0]), "{case}");
+            assert!((left[56] - 0.5).abs() < 1e-6, "{case}");
+        }
+    }
+
+    #[test]
+    fn test_queued_params_survive_reconfigure() {
+        let engine = Box::new(AutomixEngine::new(2, 48000.0, 64));
+        set(&engine, AutomixParam::Mute, 1, 1.0, 0);
+        let mut engine = engine.reconfigure(2, 48000.0, 64);
+        let mut buffers = vec![vec![0.5f32; 64]; 2];
+        run(&mut engine, &mut buffers);
+        assert!(engine.params().mute[1]);
+        assert!(buffers[1].iter().all(|&s| s == 0.0));
+    }
+
+    #[test]
+    fn test_meters_published_per_block() {
+        let mut engine = AutomixEngine::new(3, 48000.0, 480);
+        assert!(engine.read_meters().is_none());
+
+        let mut buffers = vec![vec![0.0f32; 480]; 3];
+        run(&mut engine, &mut buffers);
+        let meters = *engine.read_meters().unwrap();
+        assert_eq!(meters.sequence, 1);
+        assert_eq!(meters.num_channels, 3);
+        assert!((meters.nom - 3.0).abs() < 1e-3);
+
+        for _ in 0..20 {
+            buffers[0].fill(0.5);
+            run(&mut engine, &mut buffers);
+        }
+        let meters = *engine.read_meters().unwrap();
+        assert_eq!(meters.sequence, 21);
+        assert!((meters.nom - 1.0).abs() < 1e-3);
+        assert!((meters.channels[0].input_rms - 0.5).abs() < 1e-4);
+        assert!(meters.channels[0].gain > 0.99);
+        assert!(meters.channels[1].output_peak == 0.0);
+        assert!(engine.read_meters().is_none());
+    }
+
+    #[test]
+    fn test_worker_pool_matches_single_thread() {
+        let threaded_config = AutomixConfig {
+            num_workers: 3,
+            ..AutomixConfig::new(70, 48000.0, 200)
+        };
+        let mut single = AutomixEngine::new(70, 48000.0, 200);
+        let mut threaded = AutomixEngine::with_config(&threaded_config);
+        assert_eq!(threaded.num_threads(), 4);
+
+        let mut seed = 9;
+        let input: Vec<Vec<f32>> = (0..70)
+            .map(|c| {
+                let scale = if c % 9 == 0 { 0.5 } else { 0.01 };
+                (0..1000).map(|_| noise(&mut seed) * scale).collect()
+            })
+            .collect();
+        let (mut a, mut b) = (input.clone(), input);
+        for engine in [&single, &threaded] {
+            set(engine, AutomixParam::Mute, 18, 1.0, 130);
+            set(engine, AutomixParam::Bypass, 45, 1.0, 0);
+        }
+        run(&mut single, &mut a);
+        run(&mut threaded, &mut b);
+
+        for (x, y) in a.iter().flatten().zip(b.iter().flatten()) {
+            assert!((x - y).abs() < 1e-5, "{x} vs {y}");
+        }
+        for (x, y) in single.gains().iter().zip(threaded.gains()) {
+            assert!((x - y).abs() < 1e-5, "{x} vs {y}");
+        }
+        assert_eq!(single.in_peak[..], threaded.in_peak[..]);
+    }
+
+    #[test]
+    fn test_groups_share_independently() {
+        let mut engine = AutomixEngine::new(6, 48000.0, 480);
+        for c in 0..6 {
+            set(&engine, AutomixParam::Group, c, (c / 2) as f32, 0);
+        }
+        let mut seed = 5;
+        let mut buffers: Vec<Vec<f32>> = (0..6)
+            .map(|c| {
+                // Channel 0 talks; group 1 is silent.
+                let scale = [0.5, 0.01, 0.0, 0.0, 0.2, 0.2][c];
+                (0..480).map(|_| noise(&mut seed) * scale).collect()
+            })
+            .collect();
+        for _ in 0..20 {
+            run(&mut engine, &mut buffers);
+        }
+
+        let gains = engine.gains();
+        for pair in gains.chunks(2) {
+            assert!((pair[0] + pair[1] - 1.0).abs() < 1e-5, "{pair:?}");
+        }
+        assert!(gains[0] > 0.9);
+        let meters = *engine.read_meters().unwrap();
+        assert_eq!(meters.num_groups, 3);
+        assert!((meters.group_nom[1] - 2.0).abs() < 1e-3);
+        assert!((meters.group_nom[2] - 2.0).abs() < 0.1);
+        let total: f32 = meters.group_nom.iter().sum();
+        assert!((meters.nom - total).abs() < 1e-6);
+
+        // Moving everyone back to group 0 restores a single share.
+        for c in 0..6 {
+            set(&engine, AutomixParam::Group, c, 0.0, 0);
+        }
+        run(&mut engine, &mut buffers);
+        assert!((engine.gains().iter().sum::<f32>() - 1.0).abs() < 1e-5);
+        assert_eq!(engine.read_meters().unwrap().num_groups, 1);
+    }
+
+    #[test]
+    fn test_grouped_worker_pool_matches_single_thread() {
+        let threaded_config = AutomixConfig {
+            num_workers: 2,
+            ..AutomixConfig::new(48, 48000.0, 300)
+        };
+        let mut single = AutomixEngine::new(48, 48000.0, 300);
+        let mut threaded = AutomixEngine::with_config(&threaded_config);
+
+        let mut seed = 17;
+        let input: Vec<Vec<f32>> = (0..48)
+            .map(|c| {
+                let scale = if c % 7 == 0 { 0.5 } else { 0.01 };
+                (0..900).map(|_| noise(&mut seed) * scale).collect()
+            })
+            .collect();
+        let (mut a, mut b) = (input.clone(), input);
+        for engine in [&single, &threaded] {
+            // Groups interleave across the participants' channel ranges.
+            for c in 0..48 {
+                set(engine, AutomixParam::Group, c, (c % 5) as f32, 0);
+            }
+            set(engine, AutomixParam::Group, 3, 7.0, 420);
+        }
+        run(&mut single, &mut a);
+        run(&mut threaded, &mut b);
+
+        for (x, y) in a.iter().flatten().zip(b.iter().flatten()) {
+            assert!((x - y).abs() < 1e-5, "{x} vs {y}");
+        }
+        for (x, y) in single.gains().iter().zip(threaded.gains()) {
+            assert!((x - y).abs() < 1e-5, "{x} vs {y}");
+        }
+        assert_eq!(single.groups, 8);
+    }
+
+    #[test]
+    fn test_linked_engines_share_like_one_engine() {
+        let mut whole = AutomixEngine::new(16, 48000.0, 64);
+        let mut parts: Vec<Box<AutomixEngine>> = (0..4)
+            .map(|_| Box::new(AutomixEngine::new(4, 48000.0, 64)))
+            .collect();
+        for part in &mut parts {
+            assert!(part.link("test-linked-engines", AutomixLinkScope::Process));
+        }
+
+        let mut seed = 3;
+        for _ in 0..750 {
+            let block: Vec<Vec<f32>> = (0..16)
+                .map(|c| {
+                    let scale = if c == 6 { 0.5 } else { 0.002 };
+                    (0..64).map(|_| noise(&mut seed) * scale).collect()
+                })
+                .collect();
+            run(&mut whole, &mut block.clone());
+            for (part, chunk) in parts.iter_mut().zip(block.chunks(4)) {
+                run(part, &mut chunk.to_vec());
+            }
+        }
+
+        let linked: Vec<f32> = parts.iter().flat_map(|p| p.gains().to_vec()).collect();
+        assert!((linked.iter().sum::<f32>() - 1.0).abs() < 0.01);
+        for (x, y) in whole.gains().iter().zip(&linked) {
+            assert!((x - y).abs() < 0.01, "{x} vs {y}");
+        }
+        assert!(linked[6] > 0.8);
+
+        // A replacement built without touching the old engine starts out
+        // unlinked, and once linked takes over the old engine's slot when it
+        // adopts its state.
+        let slot = parts[0].link.clone().unwrap();
+        let old = Box::into_raw(parts.remove(0));
+        let mut replacement =
+            unsafe { AutomixEngine::replace(old, &AutomixConfig::new(4, 48000.0, 64)) };
+        assert!(!replacement.is_linked());
+        assert!(replacement.link("test-linked-engines", AutomixLinkScope::Process));
+        assert!(!Arc::ptr_eq(replacement.link.as_ref().unwrap(), &slot));
+        run(&mut replacement, &mut vec![vec![0.01f32; 64]; 4]);
+        assert!(Arc::ptr_eq(replacement.link.as_ref().unwrap(), &slot));
+        assert!(replacement.collect_retired().is_some());
+
+        // The replacement keeps the link; leaving it makes each engine
+        // share on its own again.
+        let mut part = parts.remove(1).reconfigure(4, 48000.0, 64);
+        assert!(part.is_linked());
+        part.unlink();
+        let mut buffers = vec![vec![0.01f32; 64]; 4];
+        run(&mut part, &mut buffers);
+        assert!((part.gains().iter().sum::<f32>() - 1.0).abs() < 1e-5);
+    }
+
+    #[test]
+    fn test_noise_floor_keeps_steady_noise_from_taking_gain() {
+        // Channel 0 picks up a ventilation system that switches on after
+        // one second; channel 1 carries a soft talker with pauses between
+        // syllables, peaking at about the vent's level.
+        let mut engine = AutomixEngine::new(2, 48000.0, 480);
+        let mut seed = 11;
+        let mut talker_gain_at_peaks = Vec::new();
+        for block in 0..500 {
+            let t = block as f32 * 0.01;
+            let vent = if t >= 1.0 { 0.05 } else { 0.001 };
+            let syllable = (std::f32::consts::TAU * 4.0 * t).sin().max(0.0);
+            let mut buffers = vec![
+                (0..480).map(|_| noise(&mut seed) * vent).collect(),
+                (0..480)
+                    .map(|_| noise(&mut seed) * (0.001 + 0.05 * syllable))
+                    .collect(),
+            ];
+            run(&mut engine, &mut buffers);
+            if syllable > 0.95 {
+                talker_gain_at_peaks.push((t, engine.gains()[1]));
+            }
+        }
+
+        // Before the floor catches up the vent takes half the gain at the
+        // talker's peaks; within a few seconds the talker wins them again.
+        let gain_at = |from: f32, to: f32| {
+            let gains: Vec<f32> = talker_gain_at_peaks
+                .iter()
+                .filter(|(t, _)| (from..to).contains(t))
+                .map(|&(_, g)| g)
+                .collect();
+            gains.iter().sum::<f32>() / gains.len() as f32
+        };
+        assert!(gain_at(1.2, 1.8) < 0.7);
+        assert!(gain_at(3.5, 5.0) > 0.85);
+        // The talker's pauses keep its floor far below its peaks.
+        assert!(engine.noise.floor[0] > 0.02);
+        assert!(engine.noise.floor[1] < 0.01);
+    }
+
+    #[test]
+    fn test_control_rate_follows_per_sample_sharing() {
+        for interval in [16, 32] {
+            let config = AutomixConfig {
+                control_interval: interval,
+                num_workers: 3,
+                ..AutomixConfig::new(16, 48000.0, 100)
+            };
+            let mut decimated = AutomixEngine::with_config(&config);
+            let mut reference = AutomixEngine::new(16, 48000.0, 100);
+            assert_eq!(decimated.num_threads(), 1);
+
+            let mut seed = 23;
+            for block in 0..480 {
+                // The talker moves every 250 ms; blocks of 100 samples do
+                // not line up with the control interval.
+                let talker = block / 120 % 16;
+                let input: Vec<Vec<f32>> = (0..16)
+                    .map(|c| {
+                        let scale = if c == talker { 0.3 } else { 0.001 };
+                        (0..100).map(|_| noise(&mut seed) * scale).collect()
+                    })
+                    .collect();
+                let (mut a, mut b) = (input.clone(), input);
+                run(&mut decimated, &mut a);
+                run(&mut reference, &mut b);
+
+                let sum: f32 = decimated.gains().iter().sum();
+                assert!((sum - 1.0).abs() < 1e-4, "interval {interval}: sum {sum}");
+                if block % 120 > 20 {
+                    for (x, y) in decimated.gains().iter().zip(reference.gains()) {
+                        assert!((x - y).abs() < 0.05, "interval {interval}: {x} vs {y}");
+                    }
+                }
+                if block % 120 > 60 {
+                    assert!(decimated.gains()[talker] > 0.8);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_nom_attenuates_by_open_mic_count() {
+        for (workers, interval) in [(0, 0), (3, 0), (0, 16)] {
+            let mut engine = AutomixEngine::with_config(&AutomixConfig {
+                num_workers: workers,
+                control_interval: interval,
+                ..AutomixConfig::new(64, 48000.0, 480)
+            });
+            set(&engine, AutomixParam::NomDepth, 0, 1.0, 0);
+
+            let mut seed = 31;
+            let mut last_sum = 1.0f32;
+            for block in 0..120 {
+                // One talker for half a second, then three.
+                let talkers = if block < 50 { 1 } else { 3 };
+                let mut buffers: Vec<Vec<f32>> = (0..64)
+                    .map(|c| {
+                        let scale = if c < talkers { 0.3 } else { 0.002 };
+                        (0..480).map(|_| noise(&mut seed) * scale).collect()
+                    })
+                    .collect();
+                run(&mut engine, &mut buffers);
+
+                // The master gain moves by at most a fifth of a step per
+                // 10 ms block.
+                let sum: f32 = engine.gains().iter().sum();
+                assert!((sum - last_sum).abs() < 0.09, "{workers}/{interval}: {sum}");
+                last_sum = sum;
+
+                let meters = engine.read_meters().unwrap();
+                if block == 49 {
+                    assert_eq!(meters.open_mics, 1);
+                    assert!((sum - 1.0).abs() < 1e-3, "{workers}/{interval}: {sum}");
+                }
+                if block == 119 {
+                    assert_eq!(meters.group_open_mics[0], 3);
+                    let expected = 1.0 / 3.0f32.sqrt();
+                    assert!((meters.group_nom_gain[0] - expected).abs() < 1e-4);
+                    assert!((sum - expected).abs() < 1e-3, "{workers}/{interval}: {sum}");
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_non_finite_nom_depth_is_ignored() {
+        let mut engine = AutomixEngine::new(4, 48000.0, 480);
+        set(&engine, AutomixParam::NomDepth, 0, 0.5, 0);
+        let mut seed = 43;
+        for (block, bad) in [f32::NAN, f32::INFINITY, f32::NEG_INFINITY]
+            .into_iter()
+            .cycle()
+            .take(30)
+            .enumerate()
+        {
+            set(&engine, AutomixParam::NomDepth, 0, bad, 240);
+            let mut buffers: Vec<Vec<f32>> = (0..4)
+                .map(|c| {
+                    let scale = if c < 2 { 0.3 } else { 0.002 };
+                    (0..480).map(|_| noise(&mut seed) * scale).collect()
+                })
+                .collect();
+            run(&mut engine, &mut buffers);
+            assert_eq!(engine.params().nom_depth, 0.5);
+            assert!(engine.gains().iter().all(|g| g.is_finite()), "{block}");
+            assert!(buffers.iter().flatten().all(|x| x.is_finite()), "{block}");
+        }
+    }
+
+    /// Three talkers taking turns, each speaking for a second in 4 Hz
+    /// syllables and then pausing for half a second, over a quiet floor on
+    /// all 16 channels. Returns every channel's gain at the end of every
+    /// 10 ms block, after two seconds of the floor alone to settle the
+    /// noise-floor estimates.
+    fn turn_taking(engine: &mut AutomixEngine) -> Vec<Vec<f32>> {
+        let mut seed = 37;
+        let mut gains = Vec::new();
+        for block in -200i32..450 {
+            let turn = block.rem_euclid(150);
+            let talker = (block >= 0 && turn < 100).then_some((block / 150) as usize);
+            let mut buffers: Vec<Vec<f32>> = (0..16)
+                .map(|c| {
+                    (0..480)
+                        .map(|s| {
+                            let t = (block * 480 + s as i32) as f32 / 48000.0;
+                            let syllable = 0.5 + 0.5 * (std::f32::consts::TAU * 4.0 * t).sin();
+                            let scale = if talker == Some(c) {
+                                0.3 * syllable
+                            } else {
+                                0.002
+                            };
+                            noise(&mut seed) * scale
+                        })
+                        .collect()
+                })
+                .collect();
+            run(engine, &mut buffers);
+            if block >= 0 {
+                gains.push(engine.gains().to_vec());
+            }
+        }
+        gains
+    }
+
+    #[test]
+    fn test_last_mic_hold_stops_pumping_in_turn_taking() {
+        for (workers, interval) in [(0, 0), (3, 0), (0, 16)] {
+            let config = AutomixConfig {
+                num_workers: workers,
+                control_interval: interval,
+                ..AutomixConfig::new(16, 48000.0, 480)
+            };
+            let mut held = AutomixEngine::with_config(&config);
+            let mut free = AutomixEngine::with_config(&config);
+            set(&free, AutomixParam::HoldTime, 0, 0.0, 0);
+            let held = turn_taking(&mut held);
+            let free = turn_taking(&mut free);
+
+            for block in 1..450 {
+                let (turn, talker) = (block % 150, block / 150);
+                // Past the first syllable the talker holds the gain through
+                // its own syllable gaps and the pause after it, and no
+                // channel's gain swings from one block to the next.
+                if turn >= 10 {
+                    let gain = held[block][talker];
+                    assert!(gain > 0.9, "{workers}/{interval} block {block}: {gain}");
+                    for (x, y) in held[block].iter().zip(&held[block - 1]) {
+                        assert!((x - y).abs() < 0.02, "{workers}/{interval} block {block}");
+                    }
+                }
+                // The next talker takes over within 20 ms.
+                if turn >= 2 && turn < 100 && block >= 150 {
+                    assert!(held[block][talker - 1] < 0.05);
+                }
+            }
+            // Without the hold the gain drifts back to all channels in the
+            // pauses.
+            let lowest = (110..150).map(|b| free[b][0]).fold(1.0, f32::min);
+            assert!(lowest < 0.3, "{workers}/{interval}: {lowest}");
+        }
+    }
+
+    #[test]
+    fn test_fast_reciprocal_matches_exact_division() {
+        for workers in [0, 3] {
+            let config = AutomixConfig {
+                num_workers: workers,
+                ..AutomixConfig::new(64, 48000.0, 100)
+            };
+            let mut exact = AutomixEngine::with_config(&config);
+            let mut fast = AutomixEngine::with_config(&AutomixConfig {
+                fast_reciprocal: true,
+                ..config
+            });
+
+            let mut seed = 29;
+            for block in 0..100 {
+                let talker = block / 25 % 64;
+                let input: Vec<Vec<f32>> = (0..64)
+                    .map(|c| {
+                        let scale = if c == talker { 0.3 } else { 0.002 };
+                        (0..100).map(|_| noise(&mut seed) * scale).collect()
+                    })
+                    .collect();
+                let (mut a, mut b) = (input.clone(), input);
+                run(&mut exact, &mut a);
+                run(&mut fast, &mut b);
+
+                for (x, y) in a.iter().flatten().zip(b.iter().flatten()) {
+                    assert!((x - y).abs() <= x.abs() * 1e-4 + 1e-9, "{x} vs {y}");
+                }
+                let sum: f32 = fast.gains().iter().sum();
+                assert!((sum - 1.0).abs() < 1e-3, "sum {sum}");
+            }
+        }
+    }
+
+    #[test]
+    fn test_worker_count_is_capped_and_survives_reconfigure() {
+        let config = AutomixConfig {
+            num_workers: 8,
+            ..AutomixConfig::new(40, 48000.0, 64)
+        };
+        // 40 channels are three 16-channel groups.
+        let engine = Box::new(AutomixEngine::with_config(&config));
+        assert_eq!(engine.num_threads(), 3);
+
+        let engine = engine.reconfigure(8, 48000.0, 64);
+        assert_eq!(engine.num_threads(), 1);
+        let engine = engine.reconfigure(256, 48000.0, 64);
+        assert_eq!(engine.num_threads(), 9);
+    }
+
+    /// Solo, mute and bypass toggled at random offsets on every SIMD level,
+    /// against a scalar reference: the scalar kernel with the same switches
+    /// spelled out as zero weights, muted outputs silent and bypassed ones
+    /// equal to the input.
+    #[test]
+    fn test_switches_match_scalar_reference() {
+        const CHANNELS: usize = 21;
+        const BLOCK: usize = 300;
+        let levels = [
+            SimdLevel::Scalar,
+            SimdLevel::Sse2,
+            SimdLevel::Avx2,
+            SimdLevel::Neon,
+        ];
+        for level in levels.into_iter().filter(|l| l.is_supported()) {
+            let mut engine = AutomixEngine::new(CHANNELS, 48000.0, BLOCK);
+            let mut reference = AutomixEngine::new(CHANNELS, 48000.0, BLOCK);
+            assert!(engine.set_simd_level(level));
+            assert!(reference.set_simd_level(SimdLevel::Scalar));
+
+            let mut seed = 43;
+            let pick =
+                |seed: &mut u32, n: usize| ((noise(seed) + 1.0) * 0.5 * n as f32) as usize % n;
+            let mut switches = [[false; CHANNELS]; 3];
+            let params = [AutomixParam::Solo, AutomixParam::Mute, AutomixParam::Bypass];
+            for _ in 0..50 {
+                let mut toggles: Vec<(usize, usize, usize)> = (0..4)
+                    .map(|_| {
+                        (
+                            pick(&mut seed, BLOCK),
+                            pick(&mut seed, 3),
+                            pick(&mut seed, CHANNELS),
+                        )
+                    })
+                    .collect();
+                toggles.sort_by_key(|t| t.0);
+
+                // What each channel does at every sample: 0 shares, 1 is
+                // silenced, 2 is bypassed.
+                let mut modes = vec![[0u8; CHANNELS]; BLOCK];
+                let mut next = 0;
+                for (s, mode) in modes.iter_mut().enumerate() {
+                    let mut changed = false;
+                    while next < toggles.len() && toggles[next].0 == s {
+                        let (_, switch, c) = toggles[next];
+                        switches[switch][c] = !switches[switch][c];
+                        let value = if switches[switch][c] { 1.0 } else { 0.0 };
+                        set(&engine, params[switch], c as u32, value, s as u32);
+                        changed = true;
+                        next += 1;
+                    }
+                    let any_solo = switches[0].contains(&true);
+                    for c in 0..CHANNELS {
+                        let silenced = switches[1][c] || (any_solo && !switches[0][c]);
+                        mode[c] = if silenced {
+                            1
+                        } else if switches[2][c] {
+                            2
+                        } else {
+                            0
+                        };
+                    }
+                    if changed {
+                        for c in 0..CHANNELS {
+                            let weight = if mode[c] == 0 { 1.0 } else { 0.0 };
+                            set(&reference, AutomixParam::Weight, c as u32, weight, s as u32);
+                        }
+                    }
+                }
+
+                let input: Vec<Vec<f32>> = (0..CHANNELS)
+                    .map(|c| {
+                        let scale = 0.01 + 0.3 * (c % 4) as f32;
+                        (0..BLOCK).map(|_| noise(&mut seed) * scale).collect()
+                    })
+                    .collect();
+                let (mut a, mut b) = (input.clone(), input.clone());
+                run(&mut engine, &mut a);
+                run(&mut reference, &mut b);
+
+                for (s, mode) in modes.iter().enumerate() {
+                    for c in 0..CHANNELS {
+                        let (x, y) = (a[c][s], b[c][s]);
+                        match mode[c] {
+                            0 => assert!((x - y).abs() < 1e-5, "{level:?}: {x} vs {y}"),
+                            1 => assert_eq!(x, 0.0, "{level:?}"),
+                            _ => assert_eq!(x, input[c][s], "{level:?}"),
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_simd_levels_match_scalar() {
+        for level in [SimdLevel::Sse2, SimdLevel::Avx2, SimdLevel::Neon] {
+            if !level.is_supported() {
+                continue;
+            }
+            let mut scalar = AutomixEngine::new(21, 48000.0, 517);
+            let mut vector = AutomixEngine::new(21, 48000.0, 517);
+            assert!(scalar.set_simd_level(SimdLevel::Scalar));
+            assert!(vector.set_simd_level(level));
+
+            let mut seed = 42;
+            let mut a: Vec<Vec<f32>> = (0..21)
+                .map(|_| (0..517).map(|_| noise(&mut seed)).collect())
+                .collect();
+            let mut b = a.clone();
+            run(&mut scalar, &mut a);
+            run(&mut vector, &mut b);
+
+            for (x, y) in a.iter().flatten().zip(b.iter().flatten()) {
+                assert!((x - y).abs() < 1e-5, "{level:?}: {x} vs {y}");
+            }
+        }
+    }
 }
@@ -0,0 +1,471 @@
+//! Gain sharing across engines.
+//!
+//! Engines that join the same link each claim a slot in a small table and,
+//! after every block, publish their per-group level sums there. Before every
+//! block each engine adds up the sums the others published and treats them
+//! as extra level in its own share, so mics split across several instances
+//! share gain as if they were one engine.
+//!
+//! The table lives on the heap for engines in one process, or in a POSIX
+//! shared-memory object for engines in different processes on one machine.
+//! Publishing and reading are plain atomic loads and stores: an engine never
+//! waits for another one, at the price of seeing their sums one block late.
+//! Slots whose sequence stops moving for `LINK_TIMEOUT_MS` (a stopped
+//! transport, a crashed process) drop out of the sum.
+
+use crate::AUTOMIX_MAX_GROUPS;
+use std::sync::atomic::{AtomicU32, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+
+/// Maximum number of engines in one link.
+pub const AUTOMIX_LINK_SLOTS: usize = 64;
+
+/// How long a member may stop publishing before the others ignore it.
+const LINK_TIMEOUT_MS: f32 = 100.0;
+
+/// Marks an initialised table; also guards against layout changes.
+const MAGIC: u32 = 0x4c4d_4101;
+
+/// Where linked engines may live.
+#[repr(u32)]
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum AutomixLinkScope {
+    /// Engines in the calling process.
+    Process = 0,
+    /// Engines in any process on the machine, through shared memory.
+    Machine = 1,
+}
+
+impl AutomixLinkScope {
+    pub fn from_u32(value: u32) -> Option<Self> {
+        Some(match value {
+            0 => AutomixLinkScope::Process,
+            1 => AutomixLinkScope::Machine,
+            _ => return None,
+        })
+    }
+}
+
+/// One member's published state, on its own cache line.
+#[repr(C, align(64))]
+struct Slot {
+    /// Owning process id, 0 while free.
+    owner: AtomicU32,
+    /// Bumped after every publish.
+    sequence: AtomicU32,
+    /// Per-group level sums as `f32` bits.
+    sums: [AtomicU32; AUTOMIX_MAX_GROUPS],
+}
+
+/// Shared table. All-zero bytes are a valid empty table, which is what a
+/// freshly created shared-memory object holds.
+#[repr(C)]
+struct Table {
+    magic: AtomicU32,
+    slots: [Slot; AUTOMIX_LINK_SLOTS],
+}
+
+impl Table {
+    fn zeroed() -> Self {
+        // SAFETY: atomics of zero are valid and mean "free".
+        unsafe { std::mem::zeroed() }
+    }
+
+    /// Check the magic, stamping it on a fresh table.
+    fn validate(&self) -> bool {
+        match self
+            .magic
+            .compare_exchange(0, MAGIC, Ordering::AcqRel, Ordering::Acquire)
+        {
+            Ok(_) => true,
+            Err(magic) => magic == MAGIC,
+        }
+    }
+
+    /// Claim a free slot, or one whose owner process has exited.
+    fn claim(&self) -> Option<usize> {
+        let pid = std::process::id();
+        for (index, slot) in self.slots.iter().enumerate() {
+            if slot
+                .owner
+                .compare_exchange(0, pid, Ordering::AcqRel, Ordering::Relaxed)
+                .is_ok()
+            {
+                return Some(index);
+            }
+        }
+        for (index, slot) in self.slots.iter().enumerate() {
+            let owner = slot.owner.load(Ordering::Relaxed);
+            if owner != pid
+                && !os::process_alive(owner)
+                && slot
+                    .owner
+                    .compare_exchange(owner, pid, Ordering::AcqRel, Ordering::Relaxed)
+                    .is_ok()
+            {
+                return Some(index);
+            }
+        }
+        None
+    }
+}
+
+/// Process-scope tables by name. Only locked while joining.
+static REGISTRY: Mutex<Vec<(String, Weak<Table>)>> = Mutex::new(Vec::new());
+
+enum Mapping {
+    Heap(Arc<Table>),
+    #[cfg(unix)]
+    Shared(*mut Table),
+}
+
+// SAFETY: the table is only accessed through atomics.
+unsafe impl Send for Mapping {}
+unsafe impl Sync for Mapping {}
+
+impl Mapping {
+    fn open(name: &str, scope: AutomixLinkScope) -> Option<Self> {
+        match scope {
+            AutomixLinkScope::Process => {
+                let mut registry = REGISTRY.lock().ok()?;
+                registry.retain(|(_, table)| table.strong_count() > 0);
+                let table = match registry.iter().find(|(n, _)| n == name) {
+                    Some((_, table)) => table.upgrade()?,
+                    None => {
+                        let table = Arc::new(Table::zeroed());
+                        registry.push((name.to_owned(), Arc::downgrade(&table)));
+                        table
+                    }
+                };
+                Some(Mapping::Heap(table))
+            }
+            #[cfg(unix)]
+            AutomixLinkScope::Machine => os::map_table(name).map(Mapping::Shared),
+            #[cfg(not(unix))]
+            AutomixLinkScope::Machine => None,
+        }
+    }
+
+    fn table(&self) -> &Table {
+        match self {
+            Mapping::Heap(table) => table,
+            // SAFETY: mapped for the lifetime of `self`.
+            #[cfg(unix)]
+            Mapping::Shared(table) => unsafe { &**table },
+        }
+    }
+}
+
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        #[cfg(unix)]
+        if let Mapping::Shared(table) = *self {
+            os::unmap_table(table);
+        }
+    }
+}
+
+/// An engine's membership of a link: one claimed slot. Handed on from an
+/// engine to its replacement (see `AutomixEngine::replace`), so the link
+/// sees one member across a reconfiguration, and released when the last
+/// engine holding it is dropped.
+pub(crate) struct Member {
+    mapping: Mapping,
+    slot: usize,
+    name: String,
+    scope: AutomixLinkScope,
+}
+
+impl Member {
+    /// Join link `name`, creating it if this is its first member. Returns
+    /// `None` if the link is full or its shared memory cannot be mapped.
+    pub fn join(name: &str, scope: AutomixLinkScope) -> Option<Arc<Self>> {
+        let mapping = Mapping::open(name, scope)?;
+        let table = mapping.table();
+        if !table.validate() {
+            return None;
+        }
+        let slot = table.claim()?;
+        let entry = &table.slots[slot];
+        for sum in &entry.sums {
+            sum.store(0, Ordering::Relaxed);
+        }
+        entry.sequence.fetch_add(1, Ordering::Release);
+        Some(Arc::new(Self {
+            mapping,
+            slot,
+            name: name.to_owned(),
+            scope,
+        }))
+    }
+
+    pub fn is(&self, name: &str, scope: AutomixLinkScope) -> bool {
+        self.name == name && self.scope == scope
+    }
+
+    /// Whether `other` is a member of the same link.
+    pub fn same_link(&self, other: &Member) -> bool {
+        other.is(&self.name, self.scope)
+    }
+
+    /// Publish this member's per-group level sums at the end of a block.
+    pub fn publish(&self, sums: &[f32; AUTOMIX_MAX_GROUPS]) {
+        let slot = self.slot();
+        for (dst, sum) in slot.sums.iter().zip(sums) {
+            dst.store(sum.to_bits(), Ordering::Relaxed);
+        }
+        slot.sequence.fetch_add(1, Ordering::Release);
+    }
+
+    fn slot(&self) -> &Slot {
+        &self.mapping.table().slots[self.slot]
+    }
+}
+
+impl Drop for Member {
+    fn drop(&mut self) {
+        let slot = self.slot();
+        for sum in &slot.sums {
+            sum.store(0, Ordering::Relaxed);
+        }
+        slot.owner.store(0, Ordering::Release);
+    }
+}
+
+/// What one engine last saw of another slot.
+#[derive(Clone, Copy, Default)]
+struct Peer {
+    sequence: u32,
+    /// Samples this engine processed since `sequence` last moved.
+    idle: u32,
+}
+
+/// One engine's view of the other members of its link. Reading the link
+/// never locks or allocates.
+pub(crate) struct LinkPeers {
+    peers: [Peer; AUTOMIX_LINK_SLOTS],
+    /// Samples after which a slot that stopped moving is ignored.
+    timeout: u32,
+}
+
+impl LinkPeers {
+    pub fn new(sample_rate: f32) -> Self {
+        let timeout = (LINK_TIMEOUT_MS * 0.001 * sample_rate) as u32;
+        Self {
+            peers: [Peer {
+                sequence: 0,
+                idle: timeout,
+            }; AUTOMIX_LINK_SLOTS],
+            timeout,
+        }
+    }
+
+    /// Start tracking `member`'s link. Slots count as stale until they are
+    /// seen to move, so a member that died before we joined is never picked
+    /// up.
+    pub fn watch(&mut self, member: &Member) {
+        for (peer, slot) in self.peers.iter_mut().zip(&member.mapping.table().slots) {
+            *peer = Peer {
+                sequence: slot.sequence.load(Ordering::Acquire),
+                idle: self.timeout,
+            };
+        }
+    }
+
+    /// Per-group sums the other live members of `member`'s link published,
+    /// ahead of a block of `num_samples` samples.
+    pub fn remote_sums(
+        &mut self,
+        member: &Member,
+        num_samples: usize,
+    ) -> [f32; AUTOMIX_MAX_GROUPS] {
+        let table = member.mapping.table();
+        let mut total = [0.0f32; AUTOMIX_MAX_GROUPS];
+        for (index, (peer, slot)) in self.peers.iter_mut().zip(&table.slots).enumerate() {
+            let sequence = slot.sequence.load(Ordering::Acquire);
+            if sequence != peer.sequence {
+                *peer = Peer { sequence, idle: 0 };
+            } else {
+                peer.idle = peer.idle.saturating_add(num_samples as u32);
+            }
+            if index == member.slot
+                || peer.idle > self.timeout
+                || slot.owner.load(Ordering::Relaxed) == 0
+            {
+                continue;
+            }
+            for (total, sum) in total.iter_mut().zip(&slot.sums) {
+                *total += f32::from_bits(sum.load(Ordering::Relaxed));
+            }
+        }
+        total
+    }
+}
+
+#[cfg(unix)]
+mod os {
+    use super::Table;
+    use std::ffi::{c_char, c_int, c_void, CString};
+
+    extern "C" {
+        fn shm_open(name: *const c_char, oflag: c_int, ...) -> c_int;
+        fn ftruncate(fd: c_int, length: i64) -> c_int;
+        fn close(fd: c_int) -> c_int;
+        fn mmap(
+            addr: *mut c_void,
+            len: usize,
+            prot: c_int,
+            flags: c_int,
+            fd: c_int,
+            offset: i64,
+        ) -> *mut c_void;
+        fn munmap(addr: *mut c_void, len: usize) -> c_int;
+        fn kill(pid: c_int, sig: c_int) -> c_int;
+        #[cfg(test)]
+        fn shm_unlink(name: *const c_char) -> c_int;
+    }
+
+    const O_RDWR: c_int = 2;
+    #[cfg(target_os = "linux")]
+    const O_CREAT: c_int = 0o100;
+    #[cfg(not(target_os = "linux"))]
+    const O_CREAT: c_int = 0x200;
+    const PROT_READ_WRITE: c_int = 3;
+    const MAP_SHARED: c_int = 1;
+    const ESRCH: i32 = 3;
+
+    /// Shared-memory object name for link `name`. Hashed, because macOS
+    /// limits these names to 31 bytes.
+    fn object_name(name: &str) -> CString {
+        let mut hash = 0xcbf2_9ce4_8422_2325u64;
+        for byte in name.bytes() {
+            hash = (hash ^ byte as u64).wrapping_mul(0x0100_0000_01b3);
+        }
+        CString::new(format!("/automix-link1-{hash:016x}")).unwrap()
+    }
+
+    pub fn map_table(name: &str) -> Option<*mut Table> {
+        let name = object_name(name);
+        let len = std::mem::size_of::<Table>();
+        unsafe {
+            let fd = shm_open(name.as_ptr(), O_RDWR | O_CREAT, 0o600 as c_int);
+            if fd < 0 {
+                return None;
+            }
+            // Sizing only succeeds (and is only needed) on the first open on
+            // some systems; the mapping below fails if it never happened.
+            ftruncate(fd, len as i64);
+            let ptr = mmap(
+                std::ptr::null_mut(),
+                len,
+                PROT_READ_WRITE,
+                MAP_SHARED,
+                fd,
+                0,
+            );
+            close(fd);
+            (ptr as isize != -1).then_some(ptr as *mut Table)
+        }
+    }
+
+    #[cfg(test)]
+    pub fn remove_table(name: &str) {
+        unsafe { shm_unlink(object_name(name).as_ptr()) };
+    }
+
+    pub fn unmap_table(table: *mut Table) {
+        unsafe { munmap(table as *mut c_void, std::mem::size_of::<Table>()) };
+    }
+
+    pub fn process_alive(pid: u32) -> bool {
+        let Ok(pid) = c_int::try_from(pid) else {
+            return false;
+        };
+        // EPERM still means the process exists.
+        let alive = unsafe { kill(pid, 0) } == 0;
+        alive || std::io::Error::last_os_error().raw_os_error() != Some(ESRCH)
+    }
+}
+
+/// Shared memory is only implemented on Unix; there every slot belongs to
+/// this process.
+#[cfg(not(unix))]
+mod os {
+    pub fn process_alive(_pid: u32) -> bool {
+        true
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sums(value: f32) -> [f32; AUTOMIX_MAX_GROUPS] {
+        let mut sums = [0.0; AUTOMIX_MAX_GROUPS];
+        sums[0] = value;
+        sums
+    }
+
+    fn link_pair(name: &str, scope: AutomixLinkScope) {
+        let a = Member::join(name, scope).unwrap();
+        let b = Member::join(name, scope).unwrap();
+        assert_ne!(a.slot, b.slot);
+        let mut a_peers = LinkPeers::new(48000.0);
+        let mut b_peers = LinkPeers::new(48000.0);
+        a_peers.watch(&a);
+        b_peers.watch(&b);
+
+        assert_eq!(a_peers.remote_sums(&a, 64)[0], 0.0);
+        b.publish(&sums(0.25));
+        assert_eq!(a_peers.remote_sums(&a, 64)[0], 0.25);
+        assert_eq!(b_peers.remote_sums(&b, 64)[0], 0.0);
+
+        // `b` stops publishing: it drops out after the timeout.
+        let mut remaining = 4800;
+        while remaining > 0 {
+            assert_eq!(a_peers.remote_sums(&a, 64)[0], 0.25);
+            remaining -= 64;
+        }
+        assert_eq!(a_peers.remote_sums(&a, 64)[0], 0.0);
+        b.publish(&sums(0.5));
+        assert_eq!(a_peers.remote_sums(&a, 64)[0], 0.5);
+
+        // Leaving frees the slot and clears its sums.
+        let slot = b.slot;
+        drop(b);
+        assert_eq!(a_peers.remote_sums(&a, 64)[0], 0.0);
+        let c = Member::join(name, scope).unwrap();
+        assert_eq!(c.slot, slot);
+
+        // A newcomer ignores slots until they move.
+        let mut c_peers = LinkPeers::new(48000.0);
+        c_peers.watch(&c);
+        assert_eq!(c_peers.remote_sums(&c, 64)[0], 0.0);
+        a.publish(&sums(0.125));
+        assert_eq!(c_peers.remote_sums(&c, 64)[0], 0.125);
+    }
+
+    #[test]
+    fn test_process_link() {
+        link_pair("test-process-link", AutomixLinkScope::Process);
+        assert!(Member::join("other", AutomixLinkScope::Process).is_some());
+    }
+
+    #[cfg(unix)]
+    #[test]
+    fn test_machine_link() {
+        let name = format!("test-machine-link-{}", std::process::id());
+        link_pair(&name, AutomixLinkScope::Machine);
+        os::remove_table(&name);
+    }
+
+    #[test]
+    fn test_link_is_full_at_the_slot_limit() {
+        let members: Vec<_> = (0..AUTOMIX_LINK_SLOTS)
+            .map(|_| Member::join("test-full", AutomixLinkScope::Process).unwrap())
+            .collect();
+        assert!(Member::join("test-full", AutomixLinkScope::Process).is_none());
+        drop(members);
+        assert!(Member::join("test-full", AutomixLinkScope::Process).is_some());
+    }
+}
@@ -0,0 +1,164 @@
+//! Per-block meter snapshots from the audio thread to the editor.
+//!
+//! The audio thread fills an [`AutomixMeters`] once per processed block and
+//! publishes it through a triple buffer: it always owns one slot to write,
+//! one slot holds the latest published snapshot and the reader owns the
+//! third. Publishing and reading are each a single atomic swap, so neither
+//! side can block or observe a half-written snapshot.
+
+use crate::{AUTOMIX_MAX_CHANNELS, AUTOMIX_MAX_GROUPS};
+use std::cell::UnsafeCell;
+use std::sync::atomic::{AtomicU8, Ordering};
+
+/// Meter values for one channel over the last processed block.
+#[repr(C)]
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+pub struct AutomixChannelMeter {
+    pub input_peak: f32,
+    pub input_rms: f32,
+    /// Gain applied at the end of the block (linear).
+    pub gain: f32,
+    pub output_peak: f32,
+    pub output_rms: f32,
+}
+
+/// Meter snapshot for the whole engine.
+#[repr(C)]
+#[derive(Clone, Copy, Debug)]
+pub struct AutomixMeters {
+    /// Incremented for every published snapshot.
+    pub sequence: u64,
+    pub num_channels: u32,
+    /// Effective number of open mics at the end of the block, over all
+    /// groups: (sum g)^2 / sum g^2 over the shared gains.
+    pub nom: f32,
+    /// Gain-sharing groups in use; entries of `group_nom` past it are zero.
+    pub num_groups: u32,
+    /// Effective number of open mics in each group.
+    pub group_nom: [f32; AUTOMIX_MAX_GROUPS],
+    /// Open mics counted by the NOM attenuation stage, over all groups and
+    /// per group.
+    pub open_mics: u32,
+    pub group_open_mics: [u32; AUTOMIX_MAX_GROUPS],
+    /// NOM master gain of each group at the end of the block (linear).
+    pub group_nom_gain: [f32; AUTOMIX_MAX_GROUPS],
+    pub channels: [AutomixChannelMeter; AUTOMIX_MAX_CHANNELS],
+}
+
+impl Default for AutomixMeters {
+    fn default() -> Self {
+        Self {
+            sequence: 0,
+            num_channels: 0,
+            nom: 0.0,
+            num_groups: 0,
+            group_nom: [0.0; AUTOMIX_MAX_GROUPS],
+            open_mics: 0,
+            group_open_mics: [0; AUTOMIX_MAX_GROUPS],
+            group_nom_gain: [0.0; AUTOMIX_MAX_GROUPS],
+            channels: [AutomixChannelMeter::default(); AUTOMIX_MAX_CHANNELS],
+        }
+    }
+}
+
+/// Set in `middle` when it holds a snapshot the reader has not taken yet.
+const FRESH: u8 = 0b100;
+
+/// Wait-free triple buffer of [`AutomixMeters`].
+///
+/// `publish` may only be called from one thread at a time and `read` from
+/// one (other) thread at a time.
+pub struct MeterBus {
+    slots: [UnsafeCell<AutomixMeters>; 3],
+    /// Slot owned by the writer.
+    back: AtomicU8,
+    /// Slot in transit, plus the `FRESH` flag.
+    middle: AtomicU8,
+    /// Slot owned by the reader.
+    front: AtomicU8,
+}
+
+// SAFETY: each slot is only touched by the side that currently owns its
+// index; ownership moves through the acquire/release swaps on `middle`.
+unsafe impl Sync for MeterBus {}
+
+impl Default for MeterBus {
+    fn default() -> Self {
+        Self {
+            slots: Default::default(),
+            back: AtomicU8::new(0),
+            middle: AtomicU8::new(1),
+            front: AtomicU8::new(2),
+        }
+    }
+}
+
+impl MeterBus {
+    /// Fill the writer's slot with `fill` and make it the latest snapshot.
+    pub fn publish(&self, fill: impl FnOnce(&mut AutomixMeters)) {
+        let back = self.back.load(Ordering::Relaxed);
+        // SAFETY: the writer owns `back` until the swap below.
+        fill(unsafe { &mut *self.slots[back as usize].get() });
+        let previous = self.middle.swap(back | FRESH, Ordering::AcqRel);
+        self.back.store(previous & !FRESH, Ordering::Relaxed);
+    }
+
+    /// Latest snapshot, or `None` if nothing was published since the last
+    /// call.
+    pub fn read(&self) -> Option<&AutomixMeters> {
+        if self.middle.load(Ordering::Relaxed) & FRESH == 0 {
+            return None;
+        }
+        let front = self.front.load(Ordering::Relaxed);
+        let latest = self.middle.swap(front, Ordering::AcqRel) & !FRESH;
+        self.front.store(latest, Ordering::Relaxed);
+        // SAFETY: the reader owns `latest` until its next swap.
+        Some(unsafe { &*self.slots[latest as usize].get() })
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_reader_sees_latest_snapshot_once() {
+        let bus = MeterBus::default();
+        assert!(bus.read().is_none());
+
+        bus.publish(|m| m.sequence = 1);
+        bus.publish(|m| m.sequence = 2);
+        assert_eq!(bus.read().unwrap().sequence, 2);
+        assert!(bus.read().is_none());
+
+        bus.publish(|m| m.sequence = 3);
+        assert_eq!(bus.read().unwrap().sequence, 3);
+    }
+
+    #[test]
+    fn test_snapshots_are_never_torn() {
+        let bus = std::sync::Arc::new(MeterBus::default());
+        let writer = {
+            let bus = bus.clone();
+            std::thread::spawn(move || {
+                for i in 1..=20_000u64 {
+                    bus.publish(|m| {
+                        m.sequence = i;
+                        for ch in m.channels.iter_mut() {
+                            ch.gain = i as f32;
+                        }
+                    });
+                }
+            })
+        };
+        let mut last = 0;
+        while last < 20_000 {
+            if let Some(m) = bus.read() {
+                assert!(m.sequence > last);
+                assert!(m.channels.iter().all(|ch| ch.gain == m.sequence as f32));
+                last = m.sequence;
+            }
+        }
+        writer.join().unwrap();
+    }
+}
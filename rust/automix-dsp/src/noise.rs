@@ -0,0 +1,128 @@
+//! Adaptive per-channel noise floor by minimum statistics.
+//!
+//! The floor of a channel is the lowest value its level detector reached
+//! over the last `NOISE_WINDOW_MS`, which speech (with its pauses between
+//! words) always drops back to but steady noise such as ventilation does
+//! not. The window is split into `NOISE_SUBWINDOWS` subwindows: the kernel
+//! keeps a running minimum of the current one (one `min` per sample), and
+//! once per block the engine checks whether it is complete and, if so, pushes
+//! it into a ring and takes the minimum over the ring. A rising floor is thus
+//! followed within one window and a falling one within one subwindow.
+//!
+//! The kernel subtracts the floor from the detector level before sharing,
+//! so a channel's steady noise does not earn it gain.
+
+use crate::simd::AlignedBuf;
+
+/// Length of the minimum search window.
+const NOISE_WINDOW_MS: f32 = 1600.0;
+
+/// Subwindows per window.
+const NOISE_SUBWINDOWS: usize = 8;
+
+/// Scale from the window minimum to the floor. The minimum of a detector
+/// following noise sits below the noise's typical level.
+const NOISE_FLOOR_BIAS: f32 = 1.5;
+
+pub(crate) struct NoiseFloor {
+    /// Running minimum of each lane's detector in the current subwindow.
+    pub min: AlignedBuf,
+    /// Level subtracted from each lane's detector.
+    pub floor: AlignedBuf,
+    /// `NOISE_SUBWINDOWS` rows of completed subwindow minima.
+    ring: AlignedBuf,
+    stride: usize,
+    /// Ring row the next completed subwindow goes to.
+    slot: usize,
+    /// Samples into the current subwindow.
+    elapsed: usize,
+    subwindow: usize,
+}
+
+impl NoiseFloor {
+    /// Start with a zero floor, which the first full window replaces.
+    pub fn new(stride: usize, sample_rate: f32) -> Self {
+        let mut min = AlignedBuf::zeroed(stride);
+        min.fill(f32::MAX);
+        Self {
+            min,
+            floor: AlignedBuf::zeroed(stride),
+            ring: AlignedBuf::zeroed(NOISE_SUBWINDOWS * stride),
+            stride,
+            slot: 0,
+            elapsed: 0,
+            subwindow: ((NOISE_WINDOW_MS * 0.001 * sample_rate) as usize / NOISE_SUBWINDOWS).max(1),
+        }
+    }
+
+    /// Account for `num_samples` processed samples, closing the current
+    /// subwindow once it is complete.
+    pub fn advance(&mut self, num_samples: usize) {
+        self.elapsed += num_samples;
+        if self.elapsed < self.subwindow {
+            return;
+        }
+        self.elapsed = 0;
+
+        let stride = self.stride;
+        self.ring[self.slot * stride..][..stride].copy_from_slice(&self.min);
+        self.slot = (self.slot + 1) % NOISE_SUBWINDOWS;
+        self.min.fill(f32::MAX);
+
+        self.floor.copy_from_slice(&self.ring[..stride]);
+        for row in self.ring.chunks_exact(stride).skip(1) {
+            for (floor, &min) in self.floor.iter_mut().zip(row) {
+                *floor = floor.min(min);
+            }
+        }
+        for floor in self.floor.iter_mut() {
+            *floor *= NOISE_FLOOR_BIAS;
+        }
+    }
+
+    /// Copy the estimates of the first `lanes` lanes from `source`.
+    pub fn adopt(&mut self, source: &NoiseFloor, lanes: usize) {
+        self.min[..lanes].copy_from_slice(&source.min[..lanes]);
+        self.floor[..lanes].copy_from_slice(&source.floor[..lanes]);
+        for (row, src) in self
+            .ring
+            .chunks_exact_mut(self.stride)
+            .zip(source.ring.chunks_exact(source.stride))
+        {
+            row[..lanes].copy_from_slice(&src[..lanes]);
+        }
+        self.slot = source.slot;
+        self.elapsed = source.elapsed.min(self.subwindow);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Feed lane 0 a constant detector level the way the kernel would.
+    fn feed(noise: &mut NoiseFloor, level: f32, samples: usize) {
+        for _ in 0..samples / 64 {
+            noise.min[0] = noise.min[0].min(level);
+            noise.advance(64);
+        }
+    }
+
+    #[test]
+    fn test_floor_follows_the_window_minimum() {
+        let mut noise = NoiseFloor::new(16, 48000.0);
+        feed(&mut noise, 0.001, 96_000);
+        assert!((noise.floor[0] - 0.0015).abs() < 1e-6);
+
+        // Noise switching on: the floor holds for most of a window and has
+        // caught up once the window is full of it.
+        feed(&mut noise, 0.02, 48_000);
+        assert!((noise.floor[0] - 0.0015).abs() < 1e-6);
+        feed(&mut noise, 0.02, 48_000);
+        assert!((noise.floor[0] - 0.03).abs() < 1e-6);
+
+        // Switching off is followed within a subwindow.
+        feed(&mut noise, 0.001, 10_000);
+        assert!((noise.floor[0] - 0.0015).abs() < 1e-6);
+    }
+}
@@ -0,0 +1,232 @@
+//! Number-of-open-mics (NOM) attenuation.
+//!
+//! Every open mic adds room sound and feedback paths to the mix, so on top
+//! of the share each group can be turned down by the classic 10·log10(NOM)
+//! dB, scaled by the `NomDepth` parameter (0 leaves the share untouched).
+//!
+//! Once per block the engine counts each group's open mics from the level
+//! detectors: a channel opens when its envelope rises `NOM_OPEN_RATIO` above
+//! its noise floor and closes only once it falls below `NOM_CLOSE_RATIO`, so
+//! a talker hovering around one threshold does not flicker the count. The
+//! count is mapped to a master gain through two tables built at create time,
+//! 10·log10(n) per count and a fine dB-to-gain grid, so the audio thread
+//! never calls a transcendental function. The open state also drives
+//! last-mic-hold (see [`crate::hold`]).
+//!
+//! The master gain moves towards a new target in a linear ramp of
+//! `NOM_RAMP_MS`. [`NomRamp::at`] gives its value at any sample of the block
+//! in closed form, so every worker thread can compute the gains of its rows
+//! without sharing ramp state.
+
+use crate::{AUTOMIX_MAX_CHANNELS, AUTOMIX_MAX_GROUPS};
+
+/// Envelope over the noise floor at which a closed channel opens (+12 dB).
+const NOM_OPEN_RATIO: f32 = 4.0;
+
+/// Envelope over the noise floor below which an open channel closes (+6 dB).
+const NOM_CLOSE_RATIO: f32 = 2.0;
+
+/// Floor the thresholds are measured from while the noise estimate is still
+/// lower (-60 dBFS), so an engine that has just started on silence does not
+/// count every channel open.
+const NOM_MIN_LEVEL: f32 = 1.0e-3;
+
+/// Time the master gain takes to move to a new target.
+const NOM_RAMP_MS: f32 = 50.0;
+
+/// Resolution of the dB-to-gain table. Linear interpolation between entries
+/// is within 3e-5 of the exact gain.
+const DB_STEP: f32 = 0.125;
+
+/// A group's master gain ramp over the block being processed, per group.
+#[derive(Clone, Copy)]
+pub(crate) struct NomRamp {
+    /// Gain at the start of the block.
+    pub gain: [f32; AUTOMIX_MAX_GROUPS],
+    /// Change per sample until `target` is reached.
+    pub step: [f32; AUTOMIX_MAX_GROUPS],
+    pub target: [f32; AUTOMIX_MAX_GROUPS],
+}
+
+impl NomRamp {
+    /// Master gain of group `g` once `samples` samples of the block have
+    /// been processed.
+    #[inline(always)]
+    pub fn at(&self, g: usize, samples: usize) -> f32 {
+        let gain = self.gain[g] + self.step[g] * samples as f32;
+        if self.step[g] > 0.0 {
+            gain.min(self.target[g])
+        } else {
+            gain.max(self.target[g])
+        }
+    }
+
+    /// Whether group `g` stays at unity gain for the whole block.
+    #[inline(always)]
+    pub fn is_unity(&self, g: usize) -> bool {
+        self.gain[g] == 1.0 && self.target[g] == 1.0
+    }
+}
+
+pub(crate) struct NomStage {
+    /// Hysteresis state, one bit per channel.
+    open: [u64; AUTOMIX_MAX_CHANNELS / 64],
+    /// Channels that opened in the last block.
+    opened: [u64; AUTOMIX_MAX_CHANNELS / 64],
+    /// Open channels per group at the end of the last block.
+    pub count: [u32; AUTOMIX_MAX_GROUPS],
+    pub ramp: NomRamp,
+    ramp_samples: f32,
+    /// 10·log10(n) for n open mics, 0 dB for none.
+    nom_db: Box<[f32]>,
+    /// Gain for `i * DB_STEP` dB of attenuation.
+    db_gain: Box<[f32]>,
+}
+
+impl NomStage {
+    pub fn new(sample_rate: f32) -> Self {
+        let nom_db: Box<[f32]> = (0..=AUTOMIX_MAX_CHANNELS)
+            .map(|n| 10.0 * (n.max(1) as f32).log10())
+            .collect();
+        let steps = (nom_db[AUTOMIX_MAX_CHANNELS] / DB_STEP) as usize + 2;
+        let db_gain = (0..steps)
+            .map(|i| 10.0f32.powf(-(i as f32 * DB_STEP) / 20.0))
+            .collect();
+        Self {
+            open: [0; AUTOMIX_MAX_CHANNELS / 64],
+            opened: [0; AUTOMIX_MAX_CHANNELS / 64],
+            count: [0; AUTOMIX_MAX_GROUPS],
+            ramp: NomRamp {
+                gain: [1.0; AUTOMIX_MAX_GROUPS],
+                step: [0.0; AUTOMIX_MAX_GROUPS],
+                target: [1.0; AUTOMIX_MAX_GROUPS],
+            },
+            ramp_samples: (NOM_RAMP_MS * 0.001 * sample_rate).max(1.0),
+            nom_db,
+            db_gain,
+        }
+    }
+
+    /// Whether channel `c` was open at the end of the last block.
+    pub fn is_open(&self, c: usize) -> bool {
+        self.open[c / 64] & 1 << (c % 64) != 0
+    }
+
+    /// Whether channel `c` opened in the last block.
+    pub fn opened(&self, c: usize) -> bool {
+        self.opened[c / 64] & 1 << (c % 64) != 0
+    }
+
+    /// Master gain for `open` open mics at `depth`.
+    fn gain_for(&self, open: u32, depth: f32) -> f32 {
+        let x = depth * self.nom_db[open as usize] / DB_STEP;
+        let i = x as usize;
+        let frac = x - i as f32;
+        self.db_gain[i] + (self.db_gain[i + 1] - self.db_gain[i]) * frac
+    }
+
+    /// Finish a block of `num_samples` samples: advance the ramps to its
+    /// end, recount the open mics from the detector state of each channel
+    /// and aim the ramps at the matching gains.
+    pub fn update(
+        &mut self,
+        num_samples: usize,
+        env: &[f32],
+        floor: &[f32],
+        share_weight: &[f32],
+        group: &[u8],
+        depth: f32,
+    ) {
+        for g in 0..AUTOMIX_MAX_GROUPS {
+            self.ramp.gain[g] = self.ramp.at(g, num_samples);
+        }
+
+        self.count = [0; AUTOMIX_MAX_GROUPS];
+        for (c, &g) in group.iter().enumerate() {
+            let (word, bit) = (c / 64, 1u64 << (c % 64));
+            let threshold = floor[c].max(NOM_MIN_LEVEL);
+            let open = share_weight[c] > 0.0
+                && if self.open[word] & bit != 0 {
+                    env[c] >= threshold * NOM_CLOSE_RATIO
+                } else {
+                    env[c] > threshold * NOM_OPEN_RATIO
+                };
+            if open {
+                self.opened[word] = self.opened[word] & !bit | !self.open[word] & bit;
+                self.open[word] |= bit;
+                self.count[g as usize] += 1;
+            } else {
+                self.open[word] &= !bit;
+                self.opened[word] &= !bit;
+            }
+        }
+
+        for g in 0..AUTOMIX_MAX_GROUPS {
+            let target = self.gain_for(self.count[g], depth);
+            if target != self.ramp.target[g] {
+                self.ramp.target[g] = target;
+                self.ramp.step[g] = (target - self.ramp.gain[g]) / self.ramp_samples;
+            }
+        }
+    }
+
+    /// Take over `source`'s open channels and master gains.
+    pub fn adopt(&mut self, source: &NomStage) {
+        self.open = source.open;
+        self.opened = source.opened;
+        self.count = source.count;
+        self.ramp = source.ramp;
+        for g in 0..AUTOMIX_MAX_GROUPS {
+            self.ramp.step[g] = (self.ramp.target[g] - self.ramp.gain[g]) / self.ramp_samples;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_gain_table_follows_ten_log_nom() {
+        let nom = NomStage::new(48000.0);
+        for n in 1..=AUTOMIX_MAX_CHANNELS as u32 {
+            let full = 1.0 / (n as f32).sqrt();
+            assert!((nom.gain_for(n, 1.0) - full).abs() < 3e-5, "{n}");
+            assert!((nom.gain_for(n, 0.5) - full.sqrt()).abs() < 3e-5, "{n}");
+            assert_eq!(nom.gain_for(n, 0.0), 1.0);
+        }
+        assert_eq!(nom.gain_for(0, 1.0), 1.0);
+    }
+
+    #[test]
+    fn test_count_has_hysteresis_and_gain_ramps() {
+        let mut nom = NomStage::new(48000.0);
+        let floor = [0.01; 2];
+        let weight = [1.0; 2];
+        let group = [0, 0];
+        let count = |nom: &mut NomStage, env: [f32; 2]| {
+            nom.update(480, &env, &floor, &weight, &group, 1.0);
+            nom.count[0]
+        };
+
+        assert_eq!(count(&mut nom, [0.05, 0.03]), 1);
+        // Between the thresholds a channel keeps its state.
+        assert_eq!(count(&mut nom, [0.03, 0.03]), 1);
+        assert_eq!(count(&mut nom, [0.05, 0.05]), 2);
+        assert_eq!(count(&mut nom, [0.03, 0.03]), 2);
+        assert_eq!(count(&mut nom, [0.01, 0.03]), 1);
+
+        // The ramp takes NOM_RAMP_MS to reach a new target, in steps small
+        // enough not to be heard.
+        assert_eq!(count(&mut nom, [0.05, 0.05]), 2);
+        let mut last = nom.ramp.gain[0];
+        for _ in 0..5 {
+            count(&mut nom, [0.05, 0.05]);
+            assert!(nom.ramp.gain[0] < last);
+            last = nom.ramp.gain[0];
+        }
+        assert!((last - nom.ramp.target[0]).abs() < 1e-6);
+        assert!((last - 0.5f32.sqrt()).abs() < 3e-5);
+        assert_eq!(nom.ramp.at(0, 1000), nom.ramp.target[0]);
+    }
+}
@@ -0,0 +1,151 @@
+//! Gain sharing split across a [`WorkerPool`](crate::pool::WorkerPool).
+//!
+//! Every participant owns a contiguous run of 16-channel groups. For each
+//! segment of up to `SEGMENT_ROWS` samples it copies its channels into the
+//! shared tile (or reads them in place, see [`crate::io`]), runs level
+//! detection on them and writes one partial sum per row. After a single
+//! barrier each participant adds up the partial sums of all participants
+//! itself (a few floats per row, so there is no second round trip) and
+//! applies the gains to its own channels.
+//!
+//! Mix-bus rows are partial sums as well, but nothing in the job depends on
+//! them: every participant writes its own rows for the whole job and the
+//! engine adds them up once the job is done.
+//!
+//! Partial sums alternate between two banks from one segment to the next: a
+//! participant that races ahead into segment `s + 1` cannot overwrite sums a
+//! slower one is still reading for segment `s`, because it cannot pass the
+//! barrier of `s + 1` before that participant arrives there.
+
+use crate::io::BlockIo;
+use crate::kernel::{apply_rows, detect_rows, share_scales, BusRows, RowSums, Share, TILE_SAMPLES};
+use crate::pool::SpinBarrier;
+use crate::simd::{F32s, LANE_PAD};
+use crate::AUTOMIX_MAX_GROUPS;
+
+/// Samples per barrier.
+pub(crate) const SEGMENT_ROWS: usize = 4 * TILE_SAMPLES;
+
+/// Partial sums one participant writes per segment: a row of
+/// `SEGMENT_ROWS` for every group.
+pub(crate) const PARTIALS_PER_PARTICIPANT: usize = AUTOMIX_MAX_GROUPS * SEGMENT_ROWS;
+
+/// One `process_span` call as seen by the participants.
+pub(crate) struct ParallelSpan {
+    /// Engine state across all `stride` lanes.
+    pub share: Share,
+    /// `SEGMENT_ROWS` rows of `stride` lanes.
+    pub tile: *mut f32,
+    /// Same shape as `tile`.
+    pub levels: *mut f32,
+    /// Two banks of `participants * PARTIALS_PER_PARTICIPANT` partial sums.
+    pub partials: *mut f32,
+    /// Two mix-bus rows of `bus_len` samples per participant.
+    pub bus_partials: *mut f32,
+    pub bus_len: usize,
+    pub participants: usize,
+    pub io: BlockIo,
+    pub start: usize,
+    pub len: usize,
+}
+
+/// Process participant `participant`'s channels of the span behind `job`.
+///
+/// # Safety
+/// `job` must point to a live [`ParallelSpan`] whose buffers match its
+/// engine, and every participant of `barrier` must run this concurrently.
+#[inline(always)]
+pub(crate) unsafe fn run<V: F32s>(job: *const (), participant: usize, barrier: &SpinBarrier) {
+    let job = &*(job as *const ParallelSpan);
+    let stride = job.share.stride;
+    let groups = stride / LANE_PAD;
+    let first = groups * participant / job.participants * LANE_PAD;
+    let last = groups * (participant + 1) / job.participants * LANE_PAD;
+    let k = job.share.slice(first, last - first);
+    let io = &job.io;
+    let own_bus = job.bus_partials.wrapping_add(participant * 2 * job.bus_len);
+    let bus = BusRows {
+        rows: [own_bus, own_bus.wrapping_add(job.bus_len)],
+        channels: io.bus_rows(0).channels,
+    };
+
+    let end = job.start + job.len;
+    let mut offset = job.start;
+    let mut segment = 0;
+    while offset < end {
+        let rows = (end - offset).min(SEGMENT_ROWS);
+        let bank = job
+            .partials
+            .add(segment % 2 * job.participants * PARTIALS_PER_PARTICIPANT);
+        let own = std::slice::from_raw_parts_mut(
+            bank.add(participant * PARTIALS_PER_PARTICIPANT),
+            PARTIALS_PER_PARTICIPANT,
+        );
+
+        let mut r = 0;
+        while r < rows {
+            let n = (rows - r).min(TILE_SAMPLES);
+            let tile = job.tile.add(r * stride);
+            io.load::<V>(tile, stride, first, last, offset + r, n);
+            let src = io.source::<V>(tile, stride, first, offset + r);
+            detect_rows::<V>(
+                &k,
+                src,
+                job.levels.add(r * stride + first),
+                n,
+                &mut own[r..],
+                SEGMENT_ROWS,
+            );
+            r += n;
+        }
+
+        barrier.wait();
+
+        let mut scales = RowSums([0.0; AUTOMIX_MAX_GROUPS * TILE_SAMPLES]);
+        r = 0;
+        while r < rows {
+            let n = (rows - r).min(TILE_SAMPLES);
+            for g in 0..k.groups {
+                for i in 0..n {
+                    let row = g * SEGMENT_ROWS + r + i;
+                    let mut sum = 0.0;
+                    for p in 0..job.participants {
+                        sum += *bank.add(p * PARTIALS_PER_PARTICIPANT + row);
+                    }
+                    scales.0[g * TILE_SAMPLES + i] = sum;
+                }
+                share_scales::<V>(
+                    &k,
+                    g,
+                    scales.0.as_mut_ptr().add(g * TILE_SAMPLES),
+                    n,
+                    offset + r,
+                );
+            }
+            let tile = job.tile.add(r * stride);
+            let src = io.source::<V>(tile, stride, first, offset + r);
+            let dst = io.target::<V>(tile, stride, first, offset + r);
+            apply_rows::<V>(
+                &k,
+                src,
+                dst,
+                job.levels.add(r * stride + first),
+                n,
+                &scales.0,
+                TILE_SAMPLES,
+                bus.skip(offset + r - job.start),
+            );
+            io.store::<V>(tile, stride, first, last, offset + r, n);
+            r += n;
+        }
+
+        offset += rows;
+        segment += 1;
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2,fma")]
+pub(crate) unsafe fn run_avx2(job: *const (), participant: usize, barrier: &SpinBarrier) {
+    run::<crate::simd::Avx2>(job, participant, barrier)
+}
@@ -0,0 +1,499 @@
+//! Parameter updates from control threads to the audio thread.
+//!
+//! Control threads push [`ParamUpdate`]s into a wait-free single-producer,
+//! single-consumer ring. The audio thread drains it at the start of every
+//! `process_raw` call and applies each update at its sample offset within the
+//! block. Neither side locks or allocates.
+
+use crate::{AUTOMIX_MAX_CHANNELS, AUTOMIX_MAX_GROUPS};
+use std::cell::UnsafeCell;
+use std::mem::MaybeUninit;
+use std::ops::Index;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/// Number of updates the ring can hold between two audio callbacks.
+pub const AUTOMIX_PARAM_QUEUE_CAPACITY: usize = 1024;
+
+/// Largest gain-share weight. Larger weights are clamped to it, so that a
+/// channel's weighted level cannot overflow its group's level sum.
+pub const AUTOMIX_MAX_WEIGHT: f32 = 1.0e6;
+
+/// Parameters that can be changed while processing.
+#[repr(u32)]
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum AutomixParam {
+    /// Per-channel gain-share weight, 0..AUTOMIX_MAX_WEIGHT (default 1).
+    /// Non-finite values are ignored.
+    #[default]
+    Weight = 0,
+    /// Per-channel solo: while any channel is soloed, the others are muted.
+    Solo = 1,
+    /// Per-channel mute: the channel is silenced and leaves the gain share.
+    Mute = 2,
+    /// Per-channel bypass: the channel passes at unity and leaves the gain share.
+    Bypass = 3,
+    /// NOM attenuation depth, 0..1: the fraction of the 10*log10(NOM) dB rule
+    /// applied to each group (engine-wide, channel ignored). Non-finite
+    /// values are ignored.
+    NomDepth = 4,
+    /// Last-mic-hold time in milliseconds: how long a channel that went
+    /// quiet keeps its gain while no other channel of its group is open.
+    /// The last channel to open keeps it until another one opens; 0 turns
+    /// last-mic-hold off (engine-wide, channel ignored).
+    HoldTime = 5,
+    /// Per-channel gain-sharing group, 0..AUTOMIX_MAX_GROUPS (default 0).
+    Group = 6,
+    /// Per-channel position on a stereo mix bus, -1 (left) ..1 (right),
+    /// with a constant-power pan law (default 0, -3 dB on each side).
+    /// Changes glide over `max_block_size` samples; non-finite values are
+    /// ignored.
+    Pan = 7,
+}
+
+impl AutomixParam {
+    pub fn from_u32(value: u32) -> Option<Self> {
+        Some(match value {
+            0 => AutomixParam::Weight,
+            1 => AutomixParam::Solo,
+            2 => AutomixParam::Mute,
+            3 => AutomixParam::Bypass,
+            4 => AutomixParam::NomDepth,
+            5 => AutomixParam::HoldTime,
+            6 => AutomixParam::Group,
+            7 => AutomixParam::Pan,
+            _ => return None,
+        })
+    }
+}
+
+/// One queued parameter change.
+#[derive(Clone, Copy, Debug, Default, PartialEq)]
+pub struct ParamUpdate {
+    pub param: AutomixParam,
+    pub channel: u32,
+    pub value: f32,
+    /// Sample index within the next processed block at which to apply.
+    pub sample_offset: u32,
+}
+
+/// Keeps the producer and consumer indices on separate cache lines.
+#[repr(align(64))]
+struct CachePadded<T>(T);
+
+/// Wait-free SPSC ring of [`ParamUpdate`]s.
+///
+/// `push` may only be called from one thread at a time and `pop` from one
+/// (other) thread at a time.
+pub struct ParamQueue {
+    slots: Box<[UnsafeCell<MaybeUninit<ParamUpdate>>]>,
+    head: CachePadded<AtomicUsize>,
+    tail: CachePadded<AtomicUsize>,
+}
+
+// SAFETY: slots are handed between the single producer and single consumer
+// through the acquire/release pairs on `head` and `tail`.
+unsafe impl Sync for ParamQueue {}
+
+impl Default for ParamQueue {
+    fn default() -> Self {
+        Self {
+            slots: (0..AUTOMIX_PARAM_QUEUE_CAPACITY)
+                .map(|_| UnsafeCell::new(MaybeUninit::uninit()))
+                .collect(),
+            head: CachePadded(AtomicUsize::new(0)),
+            tail: CachePadded(AtomicUsize::new(0)),
+        }
+    }
+}
+
+impl ParamQueue {
+    /// Enqueue an update. Returns `false` if the ring is full.
+    pub fn push(&self, update: ParamUpdate) -> bool {
+        let tail = self.tail.0.load(Ordering::Relaxed);
+        if tail.wrapping_sub(self.head.0.load(Ordering::Acquire)) == AUTOMIX_PARAM_QUEUE_CAPACITY {
+            return false;
+        }
+        // SAFETY: the consumer never reads slots at or past `tail`.
+        unsafe { (*self.slots[tail % AUTOMIX_PARAM_QUEUE_CAPACITY].get()).write(update) };
+        self.tail.0.store(tail.wrapping_add(1), Ordering::Release);
+        true
+    }
+
+    /// Dequeue the oldest update, if any.
+    pub fn pop(&self) -> Option<ParamUpdate> {
+        let head = self.head.0.load(Ordering::Relaxed);
+        if head == self.tail.0.load(Ordering::Acquire) {
+            return None;
+        }
+        // SAFETY: the producer published this slot before advancing `tail`.
+        let update =
+            unsafe { (*self.slots[head % AUTOMIX_PARAM_QUEUE_CAPACITY].get()).assume_init() };
+        self.head.0.store(head.wrapping_add(1), Ordering::Release);
+        Some(update)
+    }
+}
+
+const MASK_WORDS: usize = AUTOMIX_MAX_CHANNELS / 64;
+
+/// One switch for every channel, a bit each.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct ChannelMask([u64; MASK_WORDS]);
+
+impl ChannelMask {
+    pub fn get(&self, channel: usize) -> bool {
+        self.0[channel / 64] >> (channel % 64) & 1 != 0
+    }
+
+    pub fn set(&mut self, channel: usize, on: bool) {
+        let bit = 1u64 << (channel % 64);
+        let word = &mut self.0[channel / 64];
+        *word = *word & !bit | (on as u64).wrapping_neg() & bit;
+    }
+
+    pub fn any(&self) -> bool {
+        self.0.iter().any(|&w| w != 0)
+    }
+
+    /// Keep the first `channels` channels' bits and clear the rest.
+    fn truncated(&self, channels: usize) -> ChannelMask {
+        let mut mask = *self;
+        for (w, word) in mask.0.iter_mut().enumerate() {
+            let keep = channels.saturating_sub(w * 64).min(64);
+            *word &= u64::MAX.checked_shr(64 - keep as u32).unwrap_or(0);
+        }
+        mask
+    }
+}
+
+impl Index<usize> for ChannelMask {
+    type Output = bool;
+
+    fn index(&self, channel: usize) -> &bool {
+        if self.get(channel) {
+            &true
+        } else {
+            &false
+        }
+    }
+}
+
+/// Pan table entries per unit of pan position. Interpolating between 256
+/// steps across -1..1 stays within 5e-6 of the constant-power law.
+const PAN_STEPS: f32 = 128.0;
+
+/// Current parameter values, owned by the audio thread.
+#[derive(Clone)]
+pub struct ChannelParams {
+    pub weight: Vec<f32>,
+    pub solo: ChannelMask,
+    pub mute: ChannelMask,
+    pub bypass: ChannelMask,
+    pub group: Vec<u8>,
+    /// Left and right stereo mix-bus gains from each channel's pan.
+    pub pan: Vec<[f32; 2]>,
+    pub nom_depth: f32,
+    pub hold_ms: f32,
+    /// Constant-power left and right gains at pan `i / PAN_STEPS - 1`, so
+    /// that pan updates need no cos or sin on the audio thread.
+    pan_table: Box<[[f32; 2]]>,
+}
+
+impl ChannelParams {
+    pub fn new(num_channels: usize) -> Self {
+        let steps = 2 * PAN_STEPS as usize;
+        let pan_table = (0..steps + 2)
+            .map(|i| {
+                let angle = i.min(steps) as f32 / PAN_STEPS * std::f32::consts::FRAC_PI_4;
+                [angle.cos(), angle.sin()]
+            })
+            .collect();
+        let mut params = Self {
+            weight: vec![1.0; num_channels],
+            solo: ChannelMask::default(),
+            mute: ChannelMask::default(),
+            bypass: ChannelMask::default(),
+            group: vec![0; num_channels],
+            pan: Vec::new(),
+            nom_depth: 0.0,
+            hold_ms: 500.0,
+            pan_table,
+        };
+        params.pan = vec![params.pan_gains(0.0); num_channels];
+        params
+    }
+
+    /// Left and right gains for a pan position in -1..1, interpolated in
+    /// the pan table.
+    fn pan_gains(&self, pan: f32) -> [f32; 2] {
+        let x = (pan.clamp(-1.0, 1.0) + 1.0) * PAN_STEPS;
+        let i = x as usize;
+        let frac = x - i as f32;
+        let (a, b) = (self.pan_table[i], self.pan_table[i + 1]);
+        [a[0] + (b[0] - a[0]) * frac, a[1] + (b[1] - a[1]) * frac]
+    }
+
+    /// Apply one update. Updates for channels out of range are ignored.
+    pub fn apply(&mut self, update: &ParamUpdate) {
+        let channel = update.channel as usize;
+        let on = update.value >= 0.5;
+        let in_range = channel < self.weight.len();
+        match update.param {
+            AutomixParam::Weight if in_range && update.value.is_finite() => {
+                self.weight[channel] = update.value.clamp(0.0, AUTOMIX_MAX_WEIGHT)
+            }
+            AutomixParam::Solo if in_range => self.solo.set(channel, on),
+            AutomixParam::Mute if in_range => self.mute.set(channel, on),
+            AutomixParam::Bypass if in_range => self.bypass.set(channel, on),
+            AutomixParam::Group if in_range => {
+                self.group[channel] = update
+                    .value
+                    .round()
+                    .clamp(0.0, (AUTOMIX_MAX_GROUPS - 1) as f32)
+                    as u8;
+            }
+            AutomixParam::Pan if in_range && update.value.is_finite() => {
+                self.pan[channel] = self.pan_gains(update.value)
+            }
+            AutomixParam::NomDepth if update.value.is_finite() => {
+                self.nom_depth = update.value.clamp(0.0, 1.0)
+            }
+            AutomixParam::HoldTime => self.hold_ms = update.value.max(0.0),
+            _ => {}
+        }
+    }
+
+    /// Copy values for the channels both sets share.
+    pub fn copy_from(&mut self, other: &ChannelParams) {
+        let shared = self.weight.len().min(other.weight.len());
+        self.weight[..shared].copy_from_slice(&other.weight[..shared]);
+        self.solo = other.solo.truncated(shared);
+        self.mute = other.mute.truncated(shared);
+        self.bypass = other.bypass.truncated(shared);
+        self.group[..shared].copy_from_slice(&other.group[..shared]);
+        self.pan[..shared].copy_from_slice(&other.pan[..shared]);
+        self.nom_depth = other.nom_depth;
+        self.hold_ms = other.hold_ms;
+    }
+
+    /// Fill the kernel's per-lane arrays and return the number of groups in
+    /// use (one past the highest assigned group).
+    ///
+    /// `share_weight` scales each channel's level in the gain-share sum and
+    /// is zero for channels that take no part in it; `pass_gain` is added to
+    /// the shared gain and is one for bypassed channels. `group_masks` holds
+    /// `AUTOMIX_MAX_GROUPS` rows as long as `share_weight`; in row `g`, the
+    /// lanes of group `g` are all-ones and every other lane is zero.
+    /// `bus_gain` holds two such rows, the left and right stereo mix-bus
+    /// gains of each lane.
+    ///
+    /// The switches are resolved a word of 64 channels at a time and turned
+    /// into lane values by multiplying with their bits, so toggling them
+    /// costs no branches here or in the kernel.
+    pub fn write_lanes(
+        &self,
+        share_weight: &mut [f32],
+        pass_gain: &mut [f32],
+        group_masks: &mut [f32],
+        bus_gain: &mut [f32],
+    ) -> usize {
+        let lanes = share_weight.len();
+        group_masks.fill(0.0);
+        let mut groups = 1;
+        let solo_gate = (self.solo.any() as u64).wrapping_neg();
+        let mut shares = [0u64; MASK_WORDS];
+        let mut passes = [0u64; MASK_WORDS];
+        for w in 0..MASK_WORDS {
+            let silenced = self.mute.0[w] | solo_gate & !self.solo.0[w];
+            shares[w] = !silenced & !self.bypass.0[w];
+            passes[w] = !silenced & self.bypass.0[w];
+        }
+        for c in 0..self.weight.len() {
+            let group = self.group[c] as usize;
+            group_masks[group * lanes + c] = f32::from_bits(u32::MAX);
+            groups = groups.max(group + 1);
+
+            let (w, bit) = (c / 64, c % 64);
+            share_weight[c] = self.weight[c] * (shares[w] >> bit & 1) as f32;
+            pass_gain[c] = (passes[w] >> bit & 1) as f32;
+            bus_gain[c] = self.pan[c][0];
+            bus_gain[lanes + c] = self.pan[c][1];
+        }
+        groups
+    }
+}
+
+/// Sort updates by sample offset, keeping arrival order for equal offsets.
+///
+/// Insertion sort: stable, in place and allocation-free, and the drained
+/// batch is usually short and already in order.
+pub fn sort_by_offset(updates: &mut [ParamUpdate]) {
+    for i in 1..updates.len() {
+        let mut j = i;
+        while j > 0 && updates[j - 1].sample_offset > updates[j].sample_offset {
+            updates.swap(j - 1, j);
+            j -= 1;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn update(param: AutomixParam, channel: u32, value: f32, sample_offset: u32) -> ParamUpdate {
+        ParamUpdate {
+            param,
+            channel,
+            value,
+            sample_offset,
+        }
+    }
+
+    #[test]
+    fn test_queue_is_fifo_and_bounded() {
+        let queue = ParamQueue::default();
+        for i in 0..AUTOMIX_PARAM_QUEUE_CAPACITY {
+            assert!(queue.push(update(AutomixParam::Weight, i as u32, 1.0, 0)));
+        }
+        assert!(!queue.push(update(AutomixParam::Weight, 0, 1.0, 0)));
+        for i in 0..AUTOMIX_PARAM_QUEUE_CAPACITY {
+            assert_eq!(queue.pop().unwrap().channel, i as u32);
+        }
+        assert!(queue.pop().is_none());
+    }
+
+    #[test]
+    fn test_queue_across_threads() {
+        let queue = std::sync::Arc::new(ParamQueue::default());
+        let producer = {
+            let queue = queue.clone();
+            std::thread::spawn(move || {
+                for i in 0..10_000u32 {
+                    while !queue.push(update(AutomixParam::Weight, i, 0.0, 0)) {
+                        std::hint::spin_loop();
+                    }
+                }
+            })
+        };
+        let mut expected = 0;
+        while expected < 10_000 {
+            if let Some(u) = queue.pop() {
+                assert_eq!(u.channel, expected);
+                expected += 1;
+            }
+        }
+        producer.join().unwrap();
+    }
+
+    #[test]
+    fn test_sort_is_stable() {
+        let mut updates = [
+            update(AutomixParam::Mute, 0, 1.0, 8),
+            update(AutomixParam::Mute, 0, 0.0, 2),
+            update(AutomixParam::Mute, 1, 1.0, 8),
+            update(AutomixParam::Mute, 1, 0.0, 2),
+        ];
+        sort_by_offset(&mut updates);
+        let order: Vec<(u32, u32)> = updates
+            .iter()
+            .map(|u| (u.sample_offset, u.channel))
+            .collect();
+        assert_eq!(order, [(2, 0), (2, 1), (8, 0), (8, 1)]);
+    }
+
+    #[test]
+    fn test_solo_mutes_the_others() {
+        let mut params = ChannelParams::new(3);
+        params.apply(&update(AutomixParam::Solo, 1, 1.0, 0));
+        params.apply(&update(AutomixParam::Bypass, 2, 1.0, 0));
+        let (mut weight, mut pass) = ([0.0; 3], [0.0; 3]);
+        let mut masks = [0.0; 3 * AUTOMIX_MAX_GROUPS];
+        let mut bus = [0.0; 2 * 3];
+        assert_eq!(
+            params.write_lanes(&mut weight, &mut pass, &mut masks, &mut bus),
+            1
+        );
+        assert_eq!(weight, [0.0, 1.0, 0.0]);
+        assert_eq!(pass, [0.0, 0.0, 0.0]);
+    }
+
+    #[test]
+    fn test_weight_is_finite_and_bounded() {
+        let mut params = ChannelParams::new(4);
+        params.apply(&update(AutomixParam::Weight, 0, f32::NAN, 0));
+        params.apply(&update(AutomixParam::Weight, 1, f32::INFINITY, 0));
+        params.apply(&update(AutomixParam::Weight, 2, f32::NEG_INFINITY, 0));
+        params.apply(&update(AutomixParam::Weight, 3, f32::MAX, 0));
+        assert_eq!(params.weight, [1.0, 1.0, 1.0, AUTOMIX_MAX_WEIGHT]);
+        params.apply(&update(AutomixParam::Weight, 3, -2.0, 0));
+        assert_eq!(params.weight[3], 0.0);
+    }
+
+    #[test]
+    fn test_pan_table_follows_constant_power_law() {
+        let params = ChannelParams::new(1);
+        for i in 0..=2000 {
+            let pan = i as f32 / 1000.0 - 1.0;
+            let angle = (pan + 1.0) * std::f32::consts::FRAC_PI_4;
+            let [left, right] = params.pan_gains(pan);
+            assert!((left - angle.cos()).abs() < 5e-6, "{pan}: {left}");
+            assert!((right - angle.sin()).abs() < 5e-6, "{pan}: {right}");
+        }
+        assert_eq!(params.pan_gains(-2.0), params.pan_gains(-1.0));
+        assert_eq!(params.pan_gains(2.0), params.pan_gains(1.0));
+    }
+
+    #[test]
+    fn test_switch_lanes_match_per_channel_reference() {
+        let mut params = ChannelParams::new(AUTOMIX_MAX_CHANNELS);
+        let mut state = 0x1234_5678u32;
+        let mut weight = vec![0.0; AUTOMIX_MAX_CHANNELS];
+        let mut pass = vec![0.0; AUTOMIX_MAX_CHANNELS];
+        let mut masks = vec![0.0; AUTOMIX_MAX_CHANNELS * AUTOMIX_MAX_GROUPS];
+        let mut bus = vec![0.0; 2 * AUTOMIX_MAX_CHANNELS];
+        for round in 0..200 {
+            for c in 0..AUTOMIX_MAX_CHANNELS {
+                state = state.wrapping_mul(1_664_525).wrapping_add(1_013_904_223);
+                params.weight[c] = (state >> 28) as f32 * 0.25;
+                // Solo rarely, so rounds with and without any solo mix.
+                let solo = round % 2 == 0 && state >> 8 & 0x3f == 0;
+                params.solo.set(c, solo);
+                params.mute.set(c, state >> 16 & 3 == 0);
+                params.bypass.set(c, state >> 20 & 3 == 0);
+            }
+            params.write_lanes(&mut weight, &mut pass, &mut masks, &mut bus);
+
+            let any_solo = (0..AUTOMIX_MAX_CHANNELS).any(|c| params.solo[c]);
+            for c in 0..AUTOMIX_MAX_CHANNELS {
+                let silenced = params.mute[c] || (any_solo && !params.solo[c]);
+                let bypassed = params.bypass[c] && !silenced;
+                let shares = !silenced && !params.bypass[c];
+                assert_eq!(weight[c], if shares { params.weight[c] } else { 0.0 });
+                assert_eq!(pass[c], if bypassed { 1.0 } else { 0.0 });
+            }
+        }
+    }
+
+    #[test]
+    fn test_group_masks() {
+        let mut params = ChannelParams::new(3);
+        params.apply(&update(AutomixParam::Group, 1, 2.0, 0));
+        params.apply(&update(AutomixParam::Group, 2, 99.0, 0));
+        assert_eq!(params.group, [0, 2, AUTOMIX_MAX_GROUPS as u8 - 1]);
+
+        params.apply(&update(AutomixParam::Group, 2, 1.0, 0));
+        let (mut weight, mut pass) = ([0.0; 3], [0.0; 3]);
+        let mut masks = [0.0; 3 * AUTOMIX_MAX_GROUPS];
+        let mut bus = [0.0; 2 * 3];
+        assert_eq!(
+            params.write_lanes(&mut weight, &mut pass, &mut masks, &mut bus),
+            3
+        );
+        let members: Vec<u32> = masks.iter().map(|m| m.to_bits()).collect();
+        assert_eq!(
+            members[..9],
+            [u32::MAX, 0, 0, 0, 0, u32::MAX, 0, u32::MAX, 0]
+        );
+        assert!(members[9..].iter().all(|&m| m == 0));
+    }
+}
@@ -0,0 +1,334 @@
+//! Fixed pool of worker threads for the per-channel stages.
+//!
+//! The audio thread hands a job to the pool by bumping an epoch counter and
+//! takes part in it as participant 0; the workers are participants
+//! `1..participants`. Idle workers spin on the epoch for a configurable time
+//! and then park (a futex wait on Linux). The audio thread only unparks
+//! workers that actually went to sleep, so with warm workers starting a job
+//! is a single atomic increment. Inside a job, participants meet at a
+//! [`SpinBarrier`]. Workers run each job in the caller's denormal mode (see
+//! [`crate::denormals`]). Nothing here locks or allocates after
+//! construction.
+
+use crate::alloc_guard::NoAllocScope;
+use crate::denormals::{self, FlushDenormals};
+use std::cell::UnsafeCell;
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::thread::{self, JoinHandle, Thread};
+use std::time::{Duration, Instant};
+
+/// Busy-wait iterations before a waiter starts yielding its core.
+const SPINS_BEFORE_YIELD: u32 = 1 << 14;
+
+/// Work run by every participant: `run(job, participant, barrier)`.
+pub(crate) type JobFn = unsafe fn(*const (), usize, &SpinBarrier);
+
+/// Sense-reversing barrier for a fixed number of participants.
+pub(crate) struct SpinBarrier {
+    participants: usize,
+    arrived: AtomicUsize,
+    generation: AtomicUsize,
+}
+
+impl SpinBarrier {
+    pub fn new(participants: usize) -> Self {
+        Self {
+            participants,
+            arrived: AtomicUsize::new(0),
+            generation: AtomicUsize::new(0),
+        }
+    }
+
+    /// Block until all participants have called `wait`. Everything written
+    /// before the call is visible to every participant after it.
+    pub fn wait(&self) {
+        let generation = self.generation.load(Ordering::Acquire);
+        if self.arrived.fetch_add(1, Ordering::AcqRel) + 1 == self.participants {
+            self.arrived.store(0, Ordering::Relaxed);
+            self.generation.fetch_add(1, Ordering::Release);
+        } else {
+            spin_until(|| self.generation.load(Ordering::Acquire) != generation);
+        }
+    }
+}
+
+/// Spin until `done` holds. Falls back to yielding so an oversubscribed
+/// machine still makes progress; pinned workers on their own cores never get
+/// that far.
+fn spin_until(done: impl Fn() -> bool) {
+    let mut spins = 0u32;
+    while !done() {
+        if spins < SPINS_BEFORE_YIELD {
+            spins += 1;
+            std::hint::spin_loop();
+        } else {
+            thread::yield_now();
+        }
+    }
+}
+
+/// Keeps per-worker flags on separate cache lines.
+#[repr(align(64))]
+struct CachePadded<T>(T);
+
+struct PoolShared {
+    /// Incremented once per job; workers start when it changes.
+    epoch: AtomicU64,
+    /// Job for the current epoch and whether the caller flushes
+    /// subnormals, written before `epoch` is bumped.
+    job: UnsafeCell<(*const (), Option<JobFn>, bool)>,
+    /// Workers that have not finished the current job.
+    pending: AtomicUsize,
+    barrier: SpinBarrier,
+    /// Set by a worker just before it parks.
+    sleeping: Box<[CachePadded<AtomicBool>]>,
+    shutdown: AtomicBool,
+}
+
+// SAFETY: `job` is written by the single caller of `run` while no job is in
+// flight and read by workers only after observing the new epoch.
+unsafe impl Sync for PoolShared {}
+unsafe impl Send for PoolShared {}
+
+/// How the pool's threads are placed and scheduled.
+#[derive(Clone, Copy, Debug, Default)]
+pub(crate) struct PoolOptions {
+    pub workers: usize,
+    /// Pin worker `i` to CPU `first_cpu + i`.
+    pub first_cpu: Option<usize>,
+    /// SCHED_FIFO priority for the workers; 0 keeps the default policy.
+    pub realtime_priority: i32,
+    /// How long an idle worker spins before parking.
+    pub spin: Duration,
+}
+
+pub(crate) struct WorkerPool {
+    shared: Arc<PoolShared>,
+    threads: Vec<Thread>,
+    handles: Vec<JoinHandle<()>>,
+}
+
+impl WorkerPool {
+    /// Start `options.workers` threads. Pinning and priority are best effort:
+    /// without the needed privileges the workers run unpinned at normal
+    /// priority.
+    pub fn new(options: PoolOptions) -> Self {
+        let shared = Arc::new(PoolShared {
+            epoch: AtomicU64::new(0),
+            job: UnsafeCell::new((std::ptr::null(), None, false)),
+            pending: AtomicUsize::new(0),
+            barrier: SpinBarrier::new(options.workers + 1),
+            sleeping: (0..options.workers)
+                .map(|_| CachePadded(AtomicBool::new(false)))
+                .collect(),
+            shutdown: AtomicBool::new(false),
+        });
+
+        let handles: Vec<JoinHandle<()>> = (0..options.workers)
+            .map(|index| {
+                let shared = shared.clone();
+                thread::Builder::new()
+                    .name(format!("automix-worker-{index}"))
+                    .spawn(move || {
+                        if let Some(first) = options.first_cpu {
+                            os::pin_current_thread(first + index);
+                        }
+                        if options.realtime_priority > 0 {
+                            os::set_realtime_priority(options.realtime_priority);
+                        }
+                        worker_loop(&shared, index, options.spin);
+                    })
+                    .expect("failed to spawn automix worker")
+            })
+            .collect();
+        let threads = handles.iter().map(|h| h.thread().clone()).collect();
+
+        Self {
+            shared,
+            threads,
+            handles,
+        }
+    }
+
+    /// Number of threads taking part in a job, including the caller.
+    pub fn participants(&self) -> usize {
+        self.threads.len() + 1
+    }
+
+    /// Run `run(job, participant, barrier)` on every participant, with the
+    /// calling thread as participant 0, and return when all have finished.
+    ///
+    /// # Safety
+    /// `job` must stay valid until this returns and `run` must be safe to
+    /// call concurrently for distinct participants. Only one thread may call
+    /// `run` at a time.
+    pub unsafe fn run(&self, job: *const (), run: JobFn) {
+        let shared = &*self.shared;
+        *shared.job.get() = (job, Some(run), denormals::is_flushing());
+        shared.pending.store(self.threads.len(), Ordering::Relaxed);
+        shared.epoch.fetch_add(1, Ordering::SeqCst);
+        for (thread, sleeping) in self.threads.iter().zip(shared.sleeping.iter()) {
+            if sleeping.0.swap(false, Ordering::SeqCst) {
+                thread.unpark();
+            }
+        }
+
+        run(job, 0, &shared.barrier);
+        spin_until(|| shared.pending.load(Ordering::Acquire) == 0);
+    }
+}
+
+impl Drop for WorkerPool {
+    fn drop(&mut self) {
+        self.shared.shutdown.store(true, Ordering::SeqCst);
+        for thread in &self.threads {
+            thread.unpark();
+        }
+        for handle in self.handles.drain(..) {
+            let _ = handle.join();
+        }
+    }
+}
+
+fn worker_loop(shared: &PoolShared, index: usize, spin: Duration) {
+    let mut seen = 0;
+    loop {
+        let idle_since = Instant::now();
+        loop {
+            if shared.shutdown.load(Ordering::Acquire) {
+                return;
+            }
+            let epoch = shared.epoch.load(Ordering::Acquire);
+            if epoch != seen {
+                seen = epoch;
+                break;
+            }
+            if idle_since.elapsed() < spin {
+                std::hint::spin_loop();
+                continue;
+            }
+            // Announce the nap, then look once more: either this sees the
+            // new epoch or `run` sees the flag and unparks.
+            let sleeping = &shared.sleeping[index].0;
+            sleeping.store(true, Ordering::SeqCst);
+            if shared.epoch.load(Ordering::SeqCst) == seen
+                && !shared.shutdown.load(Ordering::SeqCst)
+            {
+                thread::park();
+            }
+            sleeping.store(false, Ordering::Relaxed);
+        }
+
+        let _no_alloc = NoAllocScope::enter();
+        // SAFETY: the job was published before the epoch we just observed.
+        let (job, run, flush) = unsafe { *shared.job.get() };
+        let _flush = flush.then(FlushDenormals::enter);
+        if let Some(run) = run {
+            unsafe { run(job, index + 1, &shared.barrier) };
+        }
+        shared.pending.fetch_sub(1, Ordering::Release);
+    }
+}
+
+#[cfg(target_os = "linux")]
+mod os {
+    #[repr(C)]
+    struct SchedParam {
+        sched_priority: i32,
+    }
+
+    extern "C" {
+        fn sched_setaffinity(pid: i32, cpusetsize: usize, mask: *const u8) -> i32;
+        fn pthread_self() -> usize;
+        fn pthread_setschedparam(thread: usize, policy: i32, param: *const SchedParam) -> i32;
+    }
+
+    const SCHED_FIFO: i32 = 1;
+    const CPU_SET_BYTES: usize = 128;
+
+    pub fn pin_current_thread(cpu: usize) -> bool {
+        if cpu >= CPU_SET_BYTES * 8 {
+            return false;
+        }
+        let mut mask = [0u8; CPU_SET_BYTES];
+        mask[cpu / 8] |= 1 << (cpu % 8);
+        unsafe { sched_setaffinity(0, CPU_SET_BYTES, mask.as_ptr()) == 0 }
+    }
+
+    pub fn set_realtime_priority(priority: i32) -> bool {
+        let param = SchedParam {
+            sched_priority: priority,
+        };
+        unsafe { pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0 }
+    }
+}
+
+/// Thread placement is only implemented on Linux; elsewhere the scheduler
+/// decides.
+#[cfg(not(target_os = "linux"))]
+mod os {
+    pub fn pin_current_thread(_cpu: usize) -> bool {
+        false
+    }
+
+    pub fn set_realtime_priority(_priority: i32) -> bool {
+        false
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_barrier_orders_phases() {
+        let barrier = Arc::new(SpinBarrier::new(4));
+        let counter = Arc::new(AtomicUsize::new(0));
+        let threads: Vec<_> = (0..4)
+            .map(|_| {
+                let (barrier, counter) = (barrier.clone(), counter.clone());
+                thread::spawn(move || {
+                    for round in 1..=100 {
+                        counter.fetch_add(1, Ordering::Relaxed);
+                        barrier.wait();
+                        assert_eq!(counter.load(Ordering::Relaxed), round * 4);
+                        barrier.wait();
+                    }
+                })
+            })
+            .collect();
+        for t in threads {
+            t.join().unwrap();
+        }
+    }
+
+    unsafe fn mark(job: *const (), participant: usize, barrier: &SpinBarrier) {
+        let slots = &*(job as *const [AtomicUsize; 4]);
+        slots[participant].fetch_add(1, Ordering::Relaxed);
+        barrier.wait();
+        // Every participant sees every other one's first phase.
+        for slot in slots {
+            assert!(slot.load(Ordering::Relaxed) >= 1);
+        }
+    }
+
+    #[test]
+    fn test_pool_runs_every_participant() {
+        for spin in [Duration::ZERO, Duration::from_millis(1)] {
+            let pool = WorkerPool::new(PoolOptions {
+                workers: 3,
+                spin,
+                ..PoolOptions::default()
+            });
+            assert_eq!(pool.participants(), 4);
+            let slots: [AtomicUsize; 4] = Default::default();
+            for _ in 0..50 {
+                unsafe { pool.run(&slots as *const _ as *const (), mark) };
+            }
+            for slot in &slots {
+                assert_eq!(slot.load(Ordering::Relaxed), 50);
+            }
+        }
+    }
+}
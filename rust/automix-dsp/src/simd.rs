@@ -0,0 +1,485 @@
+//! Portable SIMD lane abstraction for the DSP kernels.
+//!
+//! Kernels are written once against [`F32s`] and monomorphised per
+//! instruction set. The engine picks a [`SimdLevel`] at construction time and
+//! enters the matching instantiation through a single `#[target_feature]`
+//! function, so everything below that entry point is inlined with the right
+//! ISA enabled.
+
+#[cfg(target_arch = "aarch64")]
+use std::arch::aarch64::*;
+#[cfg(target_arch = "x86_64")]
+use std::arch::x86_64::*;
+
+/// Bound on the relative error of [`F32s::recip`] for inputs whose
+/// reciprocal is a normal float. The x86 estimate (`rcpps`) is good to
+/// 1.5 * 2^-12 and one Newton-Raphson step squares that to about 2^-22; NEON's
+/// `vrecpe` starts from 2^-8 and ends near 2^-16. Both stay inside this
+/// bound, which moves a gain by less than 0.0003 dB.
+pub const RECIP_MAX_REL_ERROR: f32 = 3.1e-5;
+
+/// Number of `f32` lanes per cache line; channel strides are padded to this.
+pub const LANE_PAD: usize = 16;
+
+/// Instruction set used by the DSP kernels.
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum SimdLevel {
+    Scalar,
+    Sse2,
+    Avx2,
+    Neon,
+}
+
+impl SimdLevel {
+    /// Best instruction set supported by the running CPU.
+    #[cfg(target_arch = "x86_64")]
+    pub fn detect() -> Self {
+        if is_x86_feature_detected!("avx2") && is_x86_feature_detected!("fma") {
+            SimdLevel::Avx2
+        } else {
+            SimdLevel::Sse2
+        }
+    }
+
+    /// Best instruction set supported by the running CPU.
+    #[cfg(target_arch = "aarch64")]
+    pub fn detect() -> Self {
+        SimdLevel::Neon
+    }
+
+    /// Best instruction set supported by the running CPU.
+    #[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+    pub fn detect() -> Self {
+        SimdLevel::Scalar
+    }
+
+    /// Whether this level can run on the current CPU.
+    pub fn is_supported(self) -> bool {
+        match self {
+            SimdLevel::Scalar => true,
+            #[cfg(target_arch = "x86_64")]
+            SimdLevel::Sse2 => true,
+            #[cfg(target_arch = "x86_64")]
+            SimdLevel::Avx2 => SimdLevel::detect() == SimdLevel::Avx2,
+            #[cfg(target_arch = "aarch64")]
+            SimdLevel::Neon => true,
+            #[allow(unreachable_patterns)]
+            _ => false,
+        }
+    }
+}
+
+/// Round `n` up to a whole number of cache lines worth of `f32` lanes.
+pub const fn padded(n: usize) -> usize {
+    (n + LANE_PAD - 1) / LANE_PAD * LANE_PAD
+}
+
+#[derive(Clone, Copy)]
+#[repr(C, align(64))]
+struct CacheLine([f32; LANE_PAD]);
+
+/// Zero-initialised, cache-line aligned `f32` buffer.
+///
+/// Aligned loads in the kernels rely on every buffer starting on a 64-byte
+/// boundary and on lengths being padded with [`padded`].
+pub struct AlignedBuf {
+    lines: Box<[CacheLine]>,
+    len: usize,
+}
+
+impl AlignedBuf {
+    pub fn zeroed(len: usize) -> Self {
+        let lines = vec![CacheLine([0.0; LANE_PAD]); padded(len) / LANE_PAD].into_boxed_slice();
+        Self { lines, len }
+    }
+
+    pub fn as_ptr(&self) -> *const f32 {
+        self.lines.as_ptr() as *const f32
+    }
+
+    pub fn as_mut_ptr(&mut self) -> *mut f32 {
+        self.lines.as_mut_ptr() as *mut f32
+    }
+}
+
+impl std::ops::Deref for AlignedBuf {
+    type Target = [f32];
+
+    fn deref(&self) -> &[f32] {
+        // SAFETY: `lines` holds at least `len` contiguous, initialised f32s.
+        unsafe { std::slice::from_raw_parts(self.as_ptr(), self.len) }
+    }
+}
+
+impl std::ops::DerefMut for AlignedBuf {
+    fn deref_mut(&mut self) -> &mut [f32] {
+        // SAFETY: as above, and we hold the only reference.
+        unsafe { std::slice::from_raw_parts_mut(self.as_mut_ptr(), self.len) }
+    }
+}
+
+/// A vector of `f32` lanes.
+///
+/// All methods are `unsafe` because the vector types are only valid inside a
+/// function compiled with the matching target feature. `load`/`store` require
+/// pointers aligned to `LANES * 4` bytes.
+pub trait F32s: Copy {
+    const LANES: usize;
+
+    unsafe fn splat(v: f32) -> Self;
+    unsafe fn load(p: *const f32) -> Self;
+    unsafe fn store(self, p: *mut f32);
+    unsafe fn add(self, o: Self) -> Self;
+    unsafe fn sub(self, o: Self) -> Self;
+    unsafe fn mul(self, o: Self) -> Self;
+    /// `self * a + b`, fused where the ISA has it.
+    unsafe fn mul_add(self, a: Self, b: Self) -> Self;
+    unsafe fn abs(self) -> Self;
+    unsafe fn max(self, o: Self) -> Self;
+    unsafe fn min(self, o: Self) -> Self;
+    /// All-ones lanes where `self > o`.
+    unsafe fn gt(self, o: Self) -> Self;
+    /// `mask ? a : b` per lane; `mask` lanes must be all-ones or all-zeros.
+    unsafe fn select(mask: Self, a: Self, b: Self) -> Self;
+    /// Sum of all lanes.
+    unsafe fn hsum(self) -> f32;
+    /// `1 / self` from the hardware estimate plus one Newton-Raphson step,
+    /// within [`RECIP_MAX_REL_ERROR`]; exact in the scalar fallback.
+    unsafe fn recip(self) -> Self;
+}
+
+impl F32s for f32 {
+    const LANES: usize = 1;
+
+    #[inline(always)]
+    unsafe fn splat(v: f32) -> Self {
+        v
+    }
+    #[inline(always)]
+    unsafe fn load(p: *const f32) -> Self {
+        *p
+    }
+    #[inline(always)]
+    unsafe fn store(self, p: *mut f32) {
+        *p = self;
+    }
+    #[inline(always)]
+    unsafe fn add(self, o: Self) -> Self {
+        self + o
+    }
+    #[inline(always)]
+    unsafe fn sub(self, o: Self) -> Self {
+        self - o
+    }
+    #[inline(always)]
+    unsafe fn mul(self, o: Self) -> Self {
+        self * o
+    }
+    #[inline(always)]
+    unsafe fn mul_add(self, a: Self, b: Self) -> Self {
+        self * a + b
+    }
+    #[inline(always)]
+    unsafe fn abs(self) -> Self {
+        f32::abs(self)
+    }
+    #[inline(always)]
+    unsafe fn max(self, o: Self) -> Self {
+        f32::max(self, o)
+    }
+    #[inline(always)]
+    unsafe fn min(self, o: Self) -> Self {
+        f32::min(self, o)
+    }
+    #[inline(always)]
+    unsafe fn gt(self, o: Self) -> Self {
+        f32::from_bits(if self > o { u32::MAX } else { 0 })
+    }
+    #[inline(always)]
+    unsafe fn select(mask: Self, a: Self, b: Self) -> Self {
+        f32::from_bits((mask.to_bits() & a.to_bits()) | (!mask.to_bits() & b.to_bits()))
+    }
+    #[inline(always)]
+    unsafe fn hsum(self) -> f32 {
+        self
+    }
+    #[inline(always)]
+    unsafe fn recip(self) -> Self {
+        1.0 / self
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[derive(Clone, Copy)]
+pub struct Sse2(__m128);
+
+#[cfg(target_arch = "x86_64")]
+impl F32s for Sse2 {
+    const LANES: usize = 4;
+
+    #[inline(always)]
+    unsafe fn splat(v: f32) -> Self {
+        Sse2(_mm_set1_ps(v))
+    }
+    #[inline(always)]
+    unsafe fn load(p: *const f32) -> Self {
+        Sse2(_mm_load_ps(p))
+    }
+    #[inline(always)]
+    unsafe fn store(self, p: *mut f32) {
+        _mm_store_ps(p, self.0)
+    }
+    #[inline(always)]
+    unsafe fn add(self, o: Self) -> Self {
+        Sse2(_mm_add_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn sub(self, o: Self) -> Self {
+        Sse2(_mm_sub_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn mul(self, o: Self) -> Self {
+        Sse2(_mm_mul_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn mul_add(self, a: Self, b: Self) -> Self {
+        Sse2(_mm_add_ps(_mm_mul_ps(self.0, a.0), b.0))
+    }
+    #[inline(always)]
+    unsafe fn abs(self) -> Self {
+        Sse2(_mm_andnot_ps(_mm_set1_ps(-0.0), self.0))
+    }
+    #[inline(always)]
+    unsafe fn max(self, o: Self) -> Self {
+        Sse2(_mm_max_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn min(self, o: Self) -> Self {
+        Sse2(_mm_min_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn gt(self, o: Self) -> Self {
+        Sse2(_mm_cmpgt_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn select(mask: Self, a: Self, b: Self) -> Self {
+        Sse2(_mm_or_ps(
+            _mm_and_ps(mask.0, a.0),
+            _mm_andnot_ps(mask.0, b.0),
+        ))
+    }
+    #[inline(always)]
+    unsafe fn hsum(self) -> f32 {
+        let hi = _mm_movehl_ps(self.0, self.0);
+        let pair = _mm_add_ps(self.0, hi);
+        let odd = _mm_shuffle_ps::<0b01>(pair, pair);
+        _mm_cvtss_f32(_mm_add_ss(pair, odd))
+    }
+    #[inline(always)]
+    unsafe fn recip(self) -> Self {
+        // r' = r * (2 - x * r)
+        let r = _mm_rcp_ps(self.0);
+        Sse2(_mm_mul_ps(
+            r,
+            _mm_sub_ps(_mm_set1_ps(2.0), _mm_mul_ps(self.0, r)),
+        ))
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[derive(Clone, Copy)]
+pub struct Avx2(__m256);
+
+#[cfg(target_arch = "x86_64")]
+impl F32s for Avx2 {
+    const LANES: usize = 8;
+
+    #[inline(always)]
+    unsafe fn splat(v: f32) -> Self {
+        Avx2(_mm256_set1_ps(v))
+    }
+    #[inline(always)]
+    unsafe fn load(p: *const f32) -> Self {
+        Avx2(_mm256_load_ps(p))
+    }
+    #[inline(always)]
+    unsafe fn store(self, p: *mut f32) {
+        _mm256_store_ps(p, self.0)
+    }
+    #[inline(always)]
+    unsafe fn add(self, o: Self) -> Self {
+        Avx2(_mm256_add_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn sub(self, o: Self) -> Self {
+        Avx2(_mm256_sub_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn mul(self, o: Self) -> Self {
+        Avx2(_mm256_mul_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn mul_add(self, a: Self, b: Self) -> Self {
+        Avx2(_mm256_fmadd_ps(self.0, a.0, b.0))
+    }
+    #[inline(always)]
+    unsafe fn abs(self) -> Self {
+        Avx2(_mm256_andnot_ps(_mm256_set1_ps(-0.0), self.0))
+    }
+    #[inline(always)]
+    unsafe fn max(self, o: Self) -> Self {
+        Avx2(_mm256_max_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn min(self, o: Self) -> Self {
+        Avx2(_mm256_min_ps(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn gt(self, o: Self) -> Self {
+        Avx2(_mm256_cmp_ps::<_CMP_GT_OQ>(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn select(mask: Self, a: Self, b: Self) -> Self {
+        Avx2(_mm256_blendv_ps(b.0, a.0, mask.0))
+    }
+    #[inline(always)]
+    unsafe fn hsum(self) -> f32 {
+        let lo = _mm256_castps256_ps128(self.0);
+        let hi = _mm256_extractf128_ps::<1>(self.0);
+        Sse2(_mm_add_ps(lo, hi)).hsum()
+    }
+    #[inline(always)]
+    unsafe fn recip(self) -> Self {
+        let r = _mm256_rcp_ps(self.0);
+        Avx2(_mm256_mul_ps(
+            r,
+            _mm256_fnmadd_ps(self.0, r, _mm256_set1_ps(2.0)),
+        ))
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+#[derive(Clone, Copy)]
+pub struct Neon(float32x4_t);
+
+#[cfg(target_arch = "aarch64")]
+impl F32s for Neon {
+    const LANES: usize = 4;
+
+    #[inline(always)]
+    unsafe fn splat(v: f32) -> Self {
+        Neon(vdupq_n_f32(v))
+    }
+    #[inline(always)]
+    unsafe fn load(p: *const f32) -> Self {
+        Neon(vld1q_f32(p))
+    }
+    #[inline(always)]
+    unsafe fn store(self, p: *mut f32) {
+        vst1q_f32(p, self.0)
+    }
+    #[inline(always)]
+    unsafe fn add(self, o: Self) -> Self {
+        Neon(vaddq_f32(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn sub(self, o: Self) -> Self {
+        Neon(vsubq_f32(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn mul(self, o: Self) -> Self {
+        Neon(vmulq_f32(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn mul_add(self, a: Self, b: Self) -> Self {
+        Neon(vfmaq_f32(b.0, self.0, a.0))
+    }
+    #[inline(always)]
+    unsafe fn abs(self) -> Self {
+        Neon(vabsq_f32(self.0))
+    }
+    #[inline(always)]
+    unsafe fn max(self, o: Self) -> Self {
+        Neon(vmaxq_f32(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn min(self, o: Self) -> Self {
+        Neon(vminq_f32(self.0, o.0))
+    }
+    #[inline(always)]
+    unsafe fn gt(self, o: Self) -> Self {
+        Neon(vreinterpretq_f32_u32(vcgtq_f32(self.0, o.0)))
+    }
+    #[inline(always)]
+    unsafe fn select(mask: Self, a: Self, b: Self) -> Self {
+        Neon(vbslq_f32(vreinterpretq_u32_f32(mask.0), a.0, b.0))
+    }
+    #[inline(always)]
+    unsafe fn hsum(self) -> f32 {
+        vaddvq_f32(self.0)
+    }
+    #[inline(always)]
+    unsafe fn recip(self) -> Self {
+        // vrecps computes (2 - x * r).
+        let r = vrecpeq_f32(self.0);
+        Neon(vmulq_f32(r, vrecpsq_f32(self.0, r)))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Largest relative error of `recip` against exact division over
+    /// positive values from 1e-30 to 1e30.
+    unsafe fn recip_error<V: F32s>() -> f32 {
+        let mut values = AlignedBuf::zeroed(4096);
+        let mut out = AlignedBuf::zeroed(4096);
+        let mut worst = 0.0f32;
+        for decade in -30..30 {
+            for (i, v) in values.iter_mut().enumerate() {
+                *v = 10f32.powi(decade) * (1.0 + 9.0 * i as f32 / 4096.0);
+            }
+            let mut i = 0;
+            while i < values.len() {
+                V::load(values.as_ptr().add(i))
+                    .recip()
+                    .store(out.as_mut_ptr().add(i));
+                i += V::LANES;
+            }
+            for (&v, &r) in values.iter().zip(out.iter()) {
+                let exact = 1.0 / v as f64;
+                worst = worst.max(((r as f64 - exact) / exact).abs() as f32);
+            }
+        }
+        worst
+    }
+
+    #[cfg(target_arch = "x86_64")]
+    #[target_feature(enable = "avx2,fma")]
+    unsafe fn recip_error_avx2() -> f32 {
+        recip_error::<Avx2>()
+    }
+
+    #[test]
+    fn test_recip_is_within_documented_error() {
+        unsafe {
+            // Correctly rounded division: half an ULP.
+            assert!(recip_error::<f32>() <= f32::EPSILON / 2.0);
+            #[cfg(target_arch = "x86_64")]
+            {
+                let sse = recip_error::<Sse2>();
+                assert!(sse < RECIP_MAX_REL_ERROR, "{sse}");
+                if SimdLevel::Avx2.is_supported() {
+                    let avx = recip_error_avx2();
+                    assert!(avx < RECIP_MAX_REL_ERROR, "{avx}");
+                }
+            }
+            #[cfg(target_arch = "aarch64")]
+            {
+                let neon = recip_error::<Neon>();
+                assert!(neon < RECIP_MAX_REL_ERROR, "{neon}");
+            }
+        }
+    }
+}
@@ -0,0 +1,311 @@
+//! Channel-major <-> sample-major tile conversion.
+//!
+//! Hosts hand the engine one buffer per channel, while the gain kernel needs
+//! every channel's value at the same sample index in one contiguous row. The
+//! transpose works in 4x4 register blocks: four channels contribute four
+//! consecutive samples each, which become four aligned row segments in the
+//! tile. A 16-sample tile of 32 channels is 2 KiB and stays in L1 while the
+//! kernel runs over it.
+//!
+//! [`gather`] and [`scatter`] are the naive per-element equivalents, kept as
+//! the reference and for benchmarking.
+
+#[cfg(target_arch = "aarch64")]
+use std::arch::aarch64::*;
+#[cfg(target_arch = "x86_64")]
+use std::arch::x86_64::*;
+
+/// Copy `rows` samples starting at `offset` from each channel buffer into
+/// the sample-major tile using 4x4 block transposes.
+///
+/// # Safety
+/// `tile` must be 16-byte aligned with `stride` a multiple of 4 and hold
+/// `rows * stride` floats; `channel_ptrs` must hold `channels` buffers of at
+/// least `offset + rows` floats.
+#[inline(always)]
+pub unsafe fn transpose_in(
+    tile: *mut f32,
+    stride: usize,
+    channel_ptrs: *const *mut f32,
+    channels: usize,
+    offset: usize,
+    rows: usize,
+) {
+    let block_channels = channels & !3;
+    let block_rows = rows & !3;
+
+    let mut c = 0;
+    while c < block_channels {
+        let src = [
+            (*channel_ptrs.add(c)).add(offset) as *const f32,
+            (*channel_ptrs.add(c + 1)).add(offset) as *const f32,
+            (*channel_ptrs.add(c + 2)).add(offset) as *const f32,
+            (*channel_ptrs.add(c + 3)).add(offset) as *const f32,
+        ];
+        let mut r = 0;
+        while r < block_rows {
+            block_in(&src, r, tile.add(r * stride + c), stride);
+            r += 4;
+        }
+        for r in block_rows..rows {
+            let row = tile.add(r * stride + c);
+            for (i, s) in src.iter().enumerate() {
+                *row.add(i) = *s.add(r);
+            }
+        }
+        c += 4;
+    }
+
+    for c in block_channels..channels {
+        let src = *channel_ptrs.add(c);
+        for r in 0..rows {
+            *tile.add(r * stride + c) = *src.add(offset + r);
+        }
+    }
+}
+
+/// Inverse of [`transpose_in`]: write the tile back to the channel buffers.
+///
+/// # Safety
+/// Same requirements as [`transpose_in`].
+#[inline(always)]
+pub unsafe fn transpose_out(
+    tile: *const f32,
+    stride: usize,
+    channel_ptrs: *const *mut f32,
+    channels: usize,
+    offset: usize,
+    rows: usize,
+) {
+    let block_channels = channels & !3;
+    let block_rows = rows & !3;
+
+    let mut c = 0;
+    while c < block_channels {
+        let dst = [
+            (*channel_ptrs.add(c)).add(offset),
+            (*channel_ptrs.add(c + 1)).add(offset),
+            (*channel_ptrs.add(c + 2)).add(offset),
+            (*channel_ptrs.add(c + 3)).add(offset),
+        ];
+        let mut r = 0;
+        while r < block_rows {
+            block_out(tile.add(r * stride + c), stride, &dst, r);
+            r += 4;
+        }
+        for r in block_rows..rows {
+            let row = tile.add(r * stride + c);
+            for (i, d) in dst.iter().enumerate() {
+                *d.add(r) = *row.add(i);
+            }
+        }
+        c += 4;
+    }
+
+    for c in block_channels..channels {
+        let dst = *channel_ptrs.add(c);
+        for r in 0..rows {
+            *dst.add(offset + r) = *tile.add(r * stride + c);
+        }
+    }
+}
+
+/// Copy `rows` samples starting at `offset` from each channel buffer into
+/// the sample-major tile, one pointer dereference per channel and sample.
+///
+/// # Safety
+/// `tile` must hold `rows * stride` floats; `channel_ptrs` must hold
+/// `channels` buffers of at least `offset + rows` floats.
+#[inline(always)]
+pub unsafe fn gather(
+    tile: *mut f32,
+    stride: usize,
+    channel_ptrs: *const *mut f32,
+    channels: usize,
+    offset: usize,
+    rows: usize,
+) {
+    for r in 0..rows {
+        let row = tile.add(r * stride);
+        for c in 0..channels {
+            *row.add(c) = *(*channel_ptrs.add(c)).add(offset + r);
+        }
+    }
+}
+
+/// Inverse of [`gather`]: write the tile back to the channel buffers.
+///
+/// # Safety
+/// Same requirements as [`gather`].
+#[inline(always)]
+pub unsafe fn scatter(
+    tile: *const f32,
+    stride: usize,
+    channel_ptrs: *const *mut f32,
+    channels: usize,
+    offset: usize,
+    rows: usize,
+) {
+    for r in 0..rows {
+        let row = tile.add(r * stride);
+        for c in 0..channels {
+            *(*channel_ptrs.add(c)).add(offset + r) = *row.add(c);
+        }
+    }
+}
+
+/// Transpose samples `r..r + 4` of four channels into four tile rows.
+#[cfg(target_arch = "x86_64")]
+#[inline(always)]
+unsafe fn block_in(src: &[*const f32; 4], r: usize, dst: *mut f32, stride: usize) {
+    let r0 = _mm_loadu_ps(src[0].add(r));
+    let r1 = _mm_loadu_ps(src[1].add(r));
+    let r2 = _mm_loadu_ps(src[2].add(r));
+    let r3 = _mm_loadu_ps(src[3].add(r));
+    let [t0, t1, t2, t3] = transpose4(r0, r1, r2, r3);
+    _mm_store_ps(dst, t0);
+    _mm_store_ps(dst.add(stride), t1);
+    _mm_store_ps(dst.add(2 * stride), t2);
+    _mm_store_ps(dst.add(3 * stride), t3);
+}
+
+/// Transpose four tile rows back into samples `r..r + 4` of four channels.
+#[cfg(target_arch = "x86_64")]
+#[inline(always)]
+unsafe fn block_out(src: *const f32, stride: usize, dst: &[*mut f32; 4], r: usize) {
+    let r0 = _mm_load_ps(src);
+    let r1 = _mm_load_ps(src.add(stride));
+    let r2 = _mm_load_ps(src.add(2 * stride));
+    let r3 = _mm_load_ps(src.add(3 * stride));
+    let [t0, t1, t2, t3] = transpose4(r0, r1, r2, r3);
+    _mm_storeu_ps(dst[0].add(r), t0);
+    _mm_storeu_ps(dst[1].add(r), t1);
+    _mm_storeu_ps(dst[2].add(r), t2);
+    _mm_storeu_ps(dst[3].add(r), t3);
+}
+
+#[cfg(target_arch = "x86_64")]
+#[inline(always)]
+unsafe fn transpose4(r0: __m128, r1: __m128, r2: __m128, r3: __m128) -> [__m128; 4] {
+    let lo01 = _mm_unpacklo_ps(r0, r1);
+    let lo23 = _mm_unpacklo_ps(r2, r3);
+    let hi01 = _mm_unpackhi_ps(r0, r1);
+    let hi23 = _mm_unpackhi_ps(r2, r3);
+    [
+        _mm_movelh_ps(lo01, lo23),
+        _mm_movehl_ps(lo23, lo01),
+        _mm_movelh_ps(hi01, hi23),
+        _mm_movehl_ps(hi23, hi01),
+    ]
+}
+
+/// Transpose samples `r..r + 4` of four channels into four tile rows.
+#[cfg(target_arch = "aarch64")]
+#[inline(always)]
+unsafe fn block_in(src: &[*const f32; 4], r: usize, dst: *mut f32, stride: usize) {
+    let [t0, t1, t2, t3] = transpose4(
+        vld1q_f32(src[0].add(r)),
+        vld1q_f32(src[1].add(r)),
+        vld1q_f32(src[2].add(r)),
+        vld1q_f32(src[3].add(r)),
+    );
+    vst1q_f32(dst, t0);
+    vst1q_f32(dst.add(stride), t1);
+    vst1q_f32(dst.add(2 * stride), t2);
+    vst1q_f32(dst.add(3 * stride), t3);
+}
+
+/// Transpose four tile rows back into samples `r..r + 4` of four channels.
+#[cfg(target_arch = "aarch64")]
+#[inline(always)]
+unsafe fn block_out(src: *const f32, stride: usize, dst: &[*mut f32; 4], r: usize) {
+    let [t0, t1, t2, t3] = transpose4(
+        vld1q_f32(src),
+        vld1q_f32(src.add(stride)),
+        vld1q_f32(src.add(2 * stride)),
+        vld1q_f32(src.add(3 * stride)),
+    );
+    vst1q_f32(dst[0].add(r), t0);
+    vst1q_f32(dst[1].add(r), t1);
+    vst1q_f32(dst[2].add(r), t2);
+    vst1q_f32(dst[3].add(r), t3);
+}
+
+#[cfg(target_arch = "aarch64")]
+#[inline(always)]
+unsafe fn transpose4(
+    r0: float32x4_t,
+    r1: float32x4_t,
+    r2: float32x4_t,
+    r3: float32x4_t,
+) -> [float32x4_t; 4] {
+    let t01 = vtrnq_f32(r0, r1);
+    let t23 = vtrnq_f32(r2, r3);
+    [
+        vcombine_f32(vget_low_f32(t01.0), vget_low_f32(t23.0)),
+        vcombine_f32(vget_low_f32(t01.1), vget_low_f32(t23.1)),
+        vcombine_f32(vget_high_f32(t01.0), vget_high_f32(t23.0)),
+        vcombine_f32(vget_high_f32(t01.1), vget_high_f32(t23.1)),
+    ]
+}
+
+/// Portable fallback for targets without a 128-bit SIMD baseline.
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+#[inline(always)]
+unsafe fn block_in(src: &[*const f32; 4], r: usize, dst: *mut f32, stride: usize) {
+    for s in 0..4 {
+        for (c, p) in src.iter().enumerate() {
+            *dst.add(s * stride + c) = *p.add(r + s);
+        }
+    }
+}
+
+/// Portable fallback for targets without a 128-bit SIMD baseline.
+#[cfg(not(any(target_arch = "x86_64", target_arch = "aarch64")))]
+#[inline(always)]
+unsafe fn block_out(src: *const f32, stride: usize, dst: &[*mut f32; 4], r: usize) {
+    for s in 0..4 {
+        for (c, p) in dst.iter().enumerate() {
+            *p.add(r + s) = *src.add(s * stride + c);
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::simd::{padded, AlignedBuf};
+
+    #[test]
+    fn test_transpose_matches_gather() {
+        for channels in [1, 3, 4, 8, 13, 32] {
+            for rows in [1, 3, 4, 7, 16] {
+                let stride = padded(channels);
+                let mut buffers: Vec<Vec<f32>> = (0..channels)
+                    .map(|c| (0..40).map(|s| (c * 1000 + s) as f32).collect())
+                    .collect();
+                let ptrs: Vec<*mut f32> = buffers.iter_mut().map(|b| b.as_mut_ptr()).collect();
+
+                let mut a = AlignedBuf::zeroed(stride * rows);
+                let mut b = AlignedBuf::zeroed(stride * rows);
+                unsafe {
+                    gather(a.as_mut_ptr(), stride, ptrs.as_ptr(), channels, 5, rows);
+                    transpose_in(b.as_mut_ptr(), stride, ptrs.as_ptr(), channels, 5, rows);
+                }
+                assert_eq!(&a[..], &b[..], "{channels} channels, {rows} rows");
+
+                for v in b.iter_mut() {
+                    *v = -*v;
+                }
+                unsafe { transpose_out(b.as_ptr(), stride, ptrs.as_ptr(), channels, 5, rows) };
+                for (c, buf) in buffers.iter().enumerate() {
+                    for (s, &v) in buf.iter().enumerate() {
+                        let expected = (c * 1000 + s) as f32;
+                        let flipped = (5..5 + rows).contains(&s);
+                        assert_eq!(v, if flipped { -expected } else { expected });
+                    }
+                }
+            }
+        }
+    }
+}
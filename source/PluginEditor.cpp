@@ -1,28 +1,106 @@
 #include "PluginEditor.h"
 
+namespace
+{
+    constexpr int kMeterRefreshHz = 30;
+    constexpr float kMeterFloorDb = -60.0f;
+
+    const juce::Colour kBackground { 0xff1a1a2e };
+    const juce::Colour kText { 0xffdfe6e9 };
+    const juce::Colour kTrack { 0xff2d2d44 };
+    const juce::Colour kInput { 0xff00b894 };
+    const juce::Colour kReduction { 0xfffdcb6e };
+    const juce::Colour kOutput { 0xff74b9ff };
+
+    // Map a linear level onto 0..1 of a meter spanning kMeterFloorDb..0 dBFS.
+    float meterProportion (float linear)
+    {
+        const auto db = juce::Decibels::gainToDecibels (linear, kMeterFloorDb);
+        return juce::jlimit (0.0f, 1.0f, juce::jmap (db, kMeterFloorDb, 0.0f, 0.0f, 1.0f));
+    }
+} // namespace
+
 AutomixEditor::AutomixEditor (AutomixProcessor& p)
     : AudioProcessorEditor (p), processor_ (p)
 {
     setSize (1200, 700);
     setResizable (true, true);
     setResizeLimits (800, 400, 2400, 1400);
+
+    startTimerHz (kMeterRefreshHz);
 }
 
-AutomixEditor::~AutomixEditor() = default;
+AutomixEditor::~AutomixEditor()
+{
+    stopTimer();
+}
+
+void AutomixEditor::timerCallback()
+{
+    if (processor_.readMeters (meters_))
+        repaint();
+}
 
 void AutomixEditor::paint (juce::Graphics& g)
 {
-    g.fillAll (juce::Colour (0xff1a1a2e));
+    g.fillAll (kBackground);
+
+    auto bounds = getLocalBounds().reduced (20);
 
-    g.setColour (juce::Colour (0xffdfe6e9));
+    g.setColour (kText);
     g.setFont (24.0f);
-    g.drawText ("AutoMix", getLocalBounds().removeFromTop (50),
-                juce::Justification::centred, true);
+    g.drawText ("AutoMix", bounds.removeFromTop (40), juce::Justification::centred, true);
 
     g.setFont (14.0f);
-    g.drawText ("Dugan-Style Automixer — Phase 0 Scaffold",
-                getLocalBounds().reduced (20),
-                juce::Justification::centred, true);
+    g.drawText ("NOM " + juce::String (meters_.nom, 1), bounds.removeFromTop (24),
+                juce::Justification::centredRight, true);
+
+    const auto numChannels = static_cast<int> (meters_.num_channels);
+    if (numChannels == 0)
+        return;
+
+    auto labels = bounds.removeFromBottom (20);
+    const auto columnWidth = static_cast<float> (bounds.getWidth()) / static_cast<float> (numChannels);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        const auto x = static_cast<float> (bounds.getX()) + columnWidth * static_cast<float> (ch);
+        const juce::Rectangle<float> column (x, static_cast<float> (bounds.getY()),
+                                             columnWidth, static_cast<float> (bounds.getHeight()));
+        paintChannelMeter (g, column.reduced (columnWidth * 0.1f, 0.0f), meters_.channels[ch]);
+
+        g.setColour (kText);
+        g.setFont (12.0f);
+        g.drawText (juce::String (ch + 1),
+                    juce::Rectangle<float> (x, static_cast<float> (labels.getY()),
+                                            columnWidth, static_cast<float> (labels.getHeight())),
+                    juce::Justification::centred, false);
+    }
+}
+
+void AutomixEditor::paintChannelMeter (juce::Graphics& g,
+                                       juce::Rectangle<float> area,
+                                       const AutomixChannelMeter& meter) const
+{
+    // Three bars per channel: input level, gain reduction (hanging from the top) and output level.
+    const auto barWidth = area.getWidth() / 3.0f;
+    auto inputBar = area.removeFromLeft (barWidth).reduced (1.0f, 0.0f);
+    auto reductionBar = area.removeFromLeft (barWidth).reduced (1.0f, 0.0f);
+    auto outputBar = area.reduced (1.0f, 0.0f);
+
+    g.setColour (kTrack);
+    g.fillRect (inputBar);
+    g.fillRect (reductionBar);
+    g.fillRect (outputBar);
+
+    g.setColour (kInput);
+    g.fillRect (inputBar.removeFromBottom (inputBar.getHeight() * meterProportion (meter.input_peak)));
+
+    g.setColour (kReduction);
+    g.fillRect (reductionBar.removeFromTop (reductionBar.getHeight() * (1.0f - meterProportion (meter.gain))));
+
+    g.setColour (kOutput);
+    g.fillRect (outputBar.removeFromBottom (outputBar.getHeight() * meterProportion (meter.output_peak)));
 }
 
 void AutomixEditor::resized()
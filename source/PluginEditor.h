@@ -2,7 +2,7 @@
 
 #include "PluginProcessor.h"
 
-class AutomixEditor : public juce::AudioProcessorEditor
+class AutomixEditor : public juce::AudioProcessorEditor, private juce::Timer
 {
 public:
     explicit AutomixEditor (AutomixProcessor&);
@@ -12,7 +12,11 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+    void paintChannelMeter (juce::Graphics&, juce::Rectangle<float> area, const AutomixChannelMeter&) const;
+
     AutomixProcessor& processor_;
+    AutomixMeters meters_ {};
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AutomixEditor)
 };
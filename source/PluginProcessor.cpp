@@ -3,51 +3,57 @@
 
 AutomixProcessor::AutomixProcessor()
     : AudioProcessor (BusesProperties()
-          .withInput ("Input", juce::AudioChannelSet::discreteChannels (kMaxChannels), true)
-          .withOutput ("Output", juce::AudioChannelSet::discreteChannels (kMaxChannels), true))
+          .withInput ("Input", juce::AudioChannelSet::discreteChannels (kDefaultChannels), true)
+          .withOutput ("Output", juce::AudioChannelSet::discreteChannels (kDefaultChannels), true))
 {
 }
 
 AutomixProcessor::~AutomixProcessor()
 {
-    if (engine_ != nullptr)
-    {
-        automix_destroy (engine_);
-        engine_ = nullptr;
-    }
+    // Destroying the current engine also frees any engine it replaced.
+    automix_destroy (engine_.exchange (nullptr));
 }
 
 void AutomixProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    if (engine_ != nullptr)
-    {
-        automix_destroy (engine_);
-    }
+    auto* current = engine_.load (std::memory_order_acquire);
+    automix_collect_retired (current);
 
-    engine_ = automix_create (
+    // The replacement takes ownership of the current engine without reading it and adopts its
+    // learned state on the audio thread, so processBlock may keep running on `current` until it
+    // sees the swap.
+    auto* replacement = automix_reconfigure (
+        current,
         static_cast<uint32_t> (getTotalNumInputChannels()),
         static_cast<float> (sampleRate),
         static_cast<uint32_t> (samplesPerBlock));
+
+    // Nothing processes the replacement yet, so it can join the link here; rejoining the link
+    // `current` is in takes over its place rather than adding a member.
+    if (linkName_.isEmpty())
+        automix_unlink (replacement);
+    else
+        automix_link (replacement, linkName_.toRawUTF8(), AutomixLinkScope_Machine);
+
+    engine_.exchange (replacement, std::memory_order_acq_rel);
 }
 
 void AutomixProcessor::releaseResources()
 {
-    if (engine_ != nullptr)
-    {
-        automix_destroy (engine_);
-        engine_ = nullptr;
-    }
+    // Keep the engine and its learned state for the next prepareToPlay; only free the one it replaced.
+    automix_collect_retired (engine_.load (std::memory_order_acquire));
 }
 
 void AutomixProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
 {
     juce::ScopedNoDenormals noDenormals;
 
-    if (engine_ == nullptr)
+    auto* engine = engine_.load (std::memory_order_acquire);
+    if (engine == nullptr)
         return;
 
     automix_process (
-        engine_,
+        engine,
         buffer.getArrayOfWritePointers(),
         static_cast<uint32_t> (buffer.getNumChannels()),
         static_cast<uint32_t> (buffer.getNumSamples()));
@@ -65,6 +71,21 @@ bool AutomixProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
     return numChannels >= 1 && numChannels <= kMaxChannels;
 }
 
+bool AutomixProcessor::setEngineParameter (AutomixParam param, int channel, float value, int sampleOffset)
+{
+    return automix_set_param (
+        engine_.load (std::memory_order_acquire),
+        static_cast<uint32_t> (param),
+        static_cast<uint32_t> (channel),
+        value,
+        static_cast<uint32_t> (sampleOffset));
+}
+
+bool AutomixProcessor::readMeters (AutomixMeters& meters) const
+{
+    return automix_read_meters (engine_.load (std::memory_order_acquire), &meters);
+}
+
 juce::AudioProcessorEditor* AutomixProcessor::createEditor()
 {
     return new AutomixEditor (*this);
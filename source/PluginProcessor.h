@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <juce_audio_processors/juce_audio_processors.h>
 
 extern "C"
@@ -12,6 +13,9 @@ class AutomixProcessor : public juce::AudioProcessor
 public:
     static constexpr int kMaxChannels = AUTOMIX_MAX_CHANNELS;
 
+    // Width of the default bus layout; hosts may negotiate anything from 1 to kMaxChannels.
+    static constexpr int kDefaultChannels = 32;
+
     AutomixProcessor();
     ~AutomixProcessor() override;
 
@@ -40,8 +44,24 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    // Queue a parameter change for the audio thread without locking. Call from the message thread.
+    // Returns false if no engine is prepared yet or the update queue is full.
+    bool setEngineParameter (AutomixParam param, int channel, float value, int sampleOffset = 0);
+
+    // Copy the latest per-block meter snapshot into `meters` without blocking the audio thread.
+    // Call from one thread only (the editor's timer). Returns false if nothing new was published.
+    bool readMeters (AutomixMeters& meters) const;
+
+    // Share gain with every other AutoMix instance on this machine, in this host or any other, that
+    // uses the same link name. An empty name (the default) keeps this instance on its own.
+    // Call from the message thread; takes effect at the next prepareToPlay.
+    void setLinkName (const juce::String& name) { linkName_ = name; }
+
 private:
-    AutomixEngine* engine_ = nullptr;
+    juce::String linkName_;
+
+    // Written only by the message thread; processBlock picks up a replacement engine on its next call.
+    std::atomic<AutomixEngine*> engine_ { nullptr };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AutomixProcessor)
 };
@@ -0,0 +1,192 @@
+#include "PluginProcessor.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    constexpr double kSampleRate = 48000.0;
+
+    // Speech-like test signal: one channel at a time talks in noise bursts shaped by a 4 Hz
+    // syllable envelope, the others carry a low room-noise floor. The talker changes every second.
+    class SpeechBursts
+    {
+    public:
+        explicit SpeechBursts (int numChannels) : numChannels_ (numChannels) {}
+
+        int talker() const { return static_cast<int> (position_ / kTurnLength) % numChannels_; }
+
+        // Samples since the current talker started.
+        juce::int64 turnPosition() const { return position_ % kTurnLength; }
+
+        void fill (juce::AudioBuffer<float>& buffer)
+        {
+            for (int s = 0; s < buffer.getNumSamples(); ++s)
+            {
+                const auto t = static_cast<double> (position_) / kSampleRate;
+                const auto syllable = 0.5 + 0.5 * std::sin (juce::MathConstants<double>::twoPi * 4.0 * t);
+                const auto speech = static_cast<float> (0.3 * (0.2 + 0.8 * syllable * syllable));
+                const int active = talker();
+
+                for (int c = 0; c < buffer.getNumChannels(); ++c)
+                {
+                    const auto noise = random_.nextFloat() * 2.0f - 1.0f;
+                    buffer.setSample (c, s, noise * (c == active ? speech : 1.0e-3f));
+                }
+                ++position_;
+            }
+        }
+
+    private:
+        static constexpr juce::int64 kTurnLength = static_cast<juce::int64> (kSampleRate);
+
+        int numChannels_;
+        juce::int64 position_ = 0;
+        juce::Random random_ { 0x5eed };
+    };
+
+    // An AutomixProcessor driven the way a host would drive it, without an editor or audio device.
+    struct TestHost
+    {
+        TestHost (int numChannels, int blockSize)
+            : buffer (numChannels, blockSize)
+        {
+            juce::AudioProcessor::BusesLayout layout;
+            layout.inputBuses.add (juce::AudioChannelSet::discreteChannels (numChannels));
+            layout.outputBuses.add (juce::AudioChannelSet::discreteChannels (numChannels));
+            REQUIRE (processor.setBusesLayout (layout));
+            prepare (blockSize);
+        }
+
+        void prepare (int blockSize)
+        {
+            processor.setRateAndBufferSizeDetails (kSampleRate, blockSize);
+            processor.prepareToPlay (kSampleRate, blockSize);
+            buffer.setSize (buffer.getNumChannels(), blockSize);
+        }
+
+        void process() { processor.processBlock (buffer, midi); }
+
+        // Per-channel gains at the end of the last processed block.
+        std::vector<float> gains()
+        {
+            AutomixMeters meters {};
+            REQUIRE (processor.readMeters (meters));
+            REQUIRE (static_cast<int> (meters.num_channels) == buffer.getNumChannels());
+
+            std::vector<float> result;
+            for (int c = 0; c < buffer.getNumChannels(); ++c)
+                result.push_back (meters.channels[c].gain);
+            return result;
+        }
+
+        static float sum (const std::vector<float>& values)
+        {
+            float total = 0.0f;
+            for (auto v : values)
+                total += v;
+            return total;
+        }
+
+        juce::ScopedJuceInitialiser_GUI juceInitialiser;
+        AutomixProcessor processor;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+    };
+} // namespace
+
+TEST_CASE ("Gains of all channels always sum to unity", "[processor]")
+{
+    TestHost host (8, 512);
+    SpeechBursts signal (8);
+
+    for (int block = 0; block < 8 * 100; ++block)
+    {
+        signal.fill (host.buffer);
+        host.process();
+        CHECK_THAT (TestHost::sum (host.gains()), Catch::Matchers::WithinAbs (1.0, 1.0e-4));
+    }
+}
+
+TEST_CASE ("The current talker receives most of the gain", "[processor]")
+{
+    TestHost host (8, 256);
+    SpeechBursts signal (8);
+
+    for (int block = 0; block < 8 * 190; ++block)
+    {
+        signal.fill (host.buffer);
+        host.process();
+        const auto gains = host.gains();
+
+        // Leave the previous talker's detector 200 ms to release.
+        if (signal.turnPosition() >= static_cast<juce::int64> (kSampleRate / 5))
+            CHECK (gains[static_cast<size_t> (signal.talker())] > 0.8f);
+    }
+}
+
+TEST_CASE ("A bypassed channel passes at unity and leaves the share", "[processor]")
+{
+    TestHost host (4, 512);
+    SpeechBursts signal (4);
+    REQUIRE (host.processor.setEngineParameter (AutomixParam_Bypass, 2, 1.0f));
+
+    for (int block = 0; block < 200; ++block)
+    {
+        signal.fill (host.buffer);
+        juce::AudioBuffer<float> input (host.buffer);
+        host.process();
+
+        for (int s = 0; s < host.buffer.getNumSamples(); ++s)
+            REQUIRE (host.buffer.getSample (2, s) == input.getSample (2, s));
+
+        const auto gains = host.gains();
+        CHECK_THAT (TestHost::sum (gains) - gains[2], Catch::Matchers::WithinAbs (1.0, 1.0e-4));
+    }
+}
+
+TEST_CASE ("Re-preparing with a new block size keeps sharing gain", "[processor]")
+{
+    TestHost host (8, 512);
+    SpeechBursts signal (8);
+
+    for (int blockSize : { 512, 128, 1024, 64 })
+    {
+        host.prepare (blockSize);
+        for (int block = 0; block < 50; ++block)
+        {
+            signal.fill (host.buffer);
+            host.process();
+            CHECK_THAT (TestHost::sum (host.gains()), Catch::Matchers::WithinAbs (1.0, 1.0e-4));
+        }
+    }
+}
+
+TEST_CASE ("processBlock cost", "[processor][benchmark]")
+{
+    for (int numChannels : { 8, 32 })
+    {
+        for (int blockSize : { 64, 512 })
+        {
+            TestHost host (numChannels, blockSize);
+            SpeechBursts signal (numChannels);
+            signal.fill (host.buffer);
+            const juce::AudioBuffer<float> source (host.buffer);
+
+            const auto name = std::to_string (numChannels) + " channels, " + std::to_string (blockSize) + " samples";
+
+            // Each run gets a fresh copy so repeated in-place processing never feeds the engine
+            // its own, ever quieter output.
+            BENCHMARK_ADVANCED (name) (Catch::Benchmark::Chronometer meter)
+            {
+                std::vector<juce::AudioBuffer<float>> buffers (static_cast<size_t> (meter.runs()), source);
+                meter.measure ([&] (int run)
+                               { host.processor.processBlock (buffers[static_cast<size_t> (run)], host.midi); });
+            };
+        }
+    }
+}
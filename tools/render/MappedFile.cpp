@@ -0,0 +1,119 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace
+{
+    std::string describeErrno (const std::string& what, const std::string& path)
+    {
+        return what + " '" + path + "': " + std::strerror (errno);
+    }
+} // namespace
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile (MappedFile&& other) noexcept
+    : data_ (std::exchange (other.data_, nullptr)), size_ (std::exchange (other.size_, 0))
+{
+}
+
+MappedFile& MappedFile::operator= (MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        data_ = std::exchange (other.data_, nullptr);
+        size_ = std::exchange (other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile MappedFile::openForReading (const std::string& path, std::string& error)
+{
+    MappedFile file;
+
+    const int fd = ::open (path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = describeErrno ("cannot open", path);
+        return file;
+    }
+
+    struct stat info {};
+    if (::fstat (fd, &info) != 0 || info.st_size <= 0)
+    {
+        error = "cannot map empty or unreadable file '" + path + "'";
+        ::close (fd);
+        return file;
+    }
+
+    void* mapped = ::mmap (nullptr, static_cast<size_t> (info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close (fd);
+
+    if (mapped == MAP_FAILED)
+    {
+        error = describeErrno ("cannot map", path);
+        return file;
+    }
+
+    file.data_ = static_cast<std::uint8_t*> (mapped);
+    file.size_ = static_cast<std::uint64_t> (info.st_size);
+    return file;
+}
+
+MappedFile MappedFile::createForWriting (const std::string& path, std::uint64_t size, std::string& error)
+{
+    MappedFile file;
+
+    const int fd = ::open (path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        error = describeErrno ("cannot create", path);
+        return file;
+    }
+
+    if (::ftruncate (fd, static_cast<off_t> (size)) != 0)
+    {
+        error = describeErrno ("cannot size", path);
+        ::close (fd);
+        return file;
+    }
+
+    void* mapped = ::mmap (nullptr, static_cast<size_t> (size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close (fd);
+
+    if (mapped == MAP_FAILED)
+    {
+        error = describeErrno ("cannot map", path);
+        return file;
+    }
+
+    file.data_ = static_cast<std::uint8_t*> (mapped);
+    file.size_ = size;
+    return file;
+}
+
+void MappedFile::adviseSequential() const
+{
+    if (data_ != nullptr)
+        ::madvise (data_, static_cast<size_t> (size_), MADV_SEQUENTIAL);
+}
+
+void MappedFile::unmap()
+{
+    if (data_ != nullptr)
+    {
+        ::munmap (data_, static_cast<size_t> (size_));
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
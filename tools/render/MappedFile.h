@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A whole file mapped into memory. Read-only mappings stream the input; writable mappings are
+// created at their final size so the output can be filled in place without write() calls.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile (MappedFile&&) noexcept;
+    MappedFile& operator= (MappedFile&&) noexcept;
+    MappedFile (const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+
+    // Both return an unmapped file and fill `error` on failure.
+    static MappedFile openForReading (const std::string& path, std::string& error);
+    static MappedFile createForWriting (const std::string& path, std::uint64_t size, std::string& error);
+
+    bool isMapped() const { return data_ != nullptr; }
+    std::uint8_t* data() const { return data_; }
+    std::uint64_t size() const { return size_; }
+
+    // Hint that the mapping will be read front to back.
+    void adviseSequential() const;
+
+private:
+    void unmap();
+
+    std::uint8_t* data_ = nullptr;
+    std::uint64_t size_ = 0;
+};
@@ -0,0 +1,261 @@
+#include "WavFile.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr std::uint16_t formatPcm = 0x0001;
+    constexpr std::uint16_t formatFloat = 0x0003;
+    constexpr std::uint16_t formatExtensible = 0xfffe;
+
+    // RF64 stores the real sizes in the ds64 chunk and this marker in the 32-bit fields.
+    constexpr std::uint32_t rf64SizeMarker = 0xffffffff;
+
+    std::uint16_t readU16 (const std::uint8_t* p)
+    {
+        return static_cast<std::uint16_t> (p[0] | (p[1] << 8));
+    }
+
+    std::uint32_t readU32 (const std::uint8_t* p)
+    {
+        return std::uint32_t { p[0] } | (std::uint32_t { p[1] } << 8) | (std::uint32_t { p[2] } << 16)
+               | (std::uint32_t { p[3] } << 24);
+    }
+
+    std::uint64_t readU64 (const std::uint8_t* p)
+    {
+        return std::uint64_t { readU32 (p) } | (std::uint64_t { readU32 (p + 4) } << 32);
+    }
+
+    void writeU16 (std::uint8_t*& p, std::uint16_t v)
+    {
+        *p++ = static_cast<std::uint8_t> (v);
+        *p++ = static_cast<std::uint8_t> (v >> 8);
+    }
+
+    void writeU32 (std::uint8_t*& p, std::uint32_t v)
+    {
+        writeU16 (p, static_cast<std::uint16_t> (v));
+        writeU16 (p, static_cast<std::uint16_t> (v >> 16));
+    }
+
+    void writeU64 (std::uint8_t*& p, std::uint64_t v)
+    {
+        writeU32 (p, static_cast<std::uint32_t> (v));
+        writeU32 (p, static_cast<std::uint32_t> (v >> 32));
+    }
+
+    void writeTag (std::uint8_t*& p, const char* tag)
+    {
+        std::memcpy (p, tag, 4);
+        p += 4;
+    }
+
+    bool isTag (const std::uint8_t* p, const char* tag)
+    {
+        return std::memcmp (p, tag, 4) == 0;
+    }
+
+    template <typename Decode>
+    void deinterleave (const std::uint8_t* src, std::size_t stride, std::size_t sampleBytes,
+                       float* const* channels, std::size_t numChannels, std::size_t numFrames, Decode decode)
+    {
+        for (std::size_t f = 0; f < numFrames; ++f)
+        {
+            const std::uint8_t* frame = src + f * stride;
+            for (std::size_t c = 0; c < numChannels; ++c)
+                channels[c][f] = decode (frame + c * sampleBytes);
+        }
+    }
+} // namespace
+
+std::uint32_t WavFormat::bytesPerSample() const
+{
+    switch (encoding)
+    {
+        case Encoding::pcm16:
+            return 2;
+        case Encoding::pcm24:
+            return 3;
+        case Encoding::pcm32:
+        case Encoding::float32:
+            return 4;
+    }
+    return 4;
+}
+
+bool parseWavHeader (const std::uint8_t* file, std::uint64_t fileSize, WavFormat& format, std::string& error)
+{
+    if (fileSize < 12 || ! (isTag (file, "RIFF") || isTag (file, "RF64")) || ! isTag (file + 8, "WAVE"))
+    {
+        error = "not a RIFF/WAVE or RF64 file";
+        return false;
+    }
+
+    std::uint64_t ds64DataSize = 0;
+    bool haveFormat = false;
+    std::uint16_t formatTag = 0;
+    std::uint16_t bitsPerSample = 0;
+
+    std::uint64_t pos = 12;
+    while (pos + 8 <= fileSize)
+    {
+        const std::uint8_t* chunk = file + pos;
+        std::uint64_t chunkSize = readU32 (chunk + 4);
+        const std::uint8_t* body = chunk + 8;
+        const std::uint64_t remaining = fileSize - (pos + 8);
+
+        // Only the data chunk may run past the end of the file (see below); every other chunk
+        // body is read in full, so it has to fit.
+        if (! isTag (chunk, "data") && chunkSize > remaining)
+        {
+            error = "truncated '" + std::string (reinterpret_cast<const char*> (chunk), 4) + "' chunk";
+            return false;
+        }
+
+        if (isTag (chunk, "ds64"))
+        {
+            if (chunkSize < 16)
+            {
+                error = "ds64 chunk too short";
+                return false;
+            }
+            ds64DataSize = readU64 (body + 8);
+        }
+        else if (isTag (chunk, "fmt "))
+        {
+            if (chunkSize < 16)
+            {
+                error = "fmt chunk too short";
+                return false;
+            }
+            formatTag = readU16 (body);
+            format.numChannels = readU16 (body + 2);
+            format.sampleRate = readU32 (body + 4);
+            bitsPerSample = readU16 (body + 14);
+
+            // The sub-format GUID starts with the plain format tag.
+            if (formatTag == formatExtensible && chunkSize >= 40)
+                formatTag = readU16 (body + 24);
+
+            haveFormat = true;
+        }
+        else if (isTag (chunk, "data"))
+        {
+            if (! haveFormat)
+            {
+                error = "data chunk before fmt chunk";
+                return false;
+            }
+
+            if (chunkSize == rf64SizeMarker && ds64DataSize != 0)
+                chunkSize = ds64DataSize;
+
+            if (formatTag == formatPcm && bitsPerSample == 16)
+                format.encoding = WavFormat::Encoding::pcm16;
+            else if (formatTag == formatPcm && bitsPerSample == 24)
+                format.encoding = WavFormat::Encoding::pcm24;
+            else if (formatTag == formatPcm && bitsPerSample == 32)
+                format.encoding = WavFormat::Encoding::pcm32;
+            else if (formatTag == formatFloat && bitsPerSample == 32)
+                format.encoding = WavFormat::Encoding::float32;
+            else
+            {
+                error = "unsupported sample format (format " + std::to_string (formatTag) + ", "
+                        + std::to_string (bitsPerSample) + " bits)";
+                return false;
+            }
+
+            if (format.numChannels == 0 || format.sampleRate == 0)
+            {
+                error = "invalid channel count or sample rate";
+                return false;
+            }
+
+            // Tolerate files whose data chunk was not finalised or was truncated.
+            format.dataOffset = pos + 8;
+            const std::uint64_t available = fileSize - format.dataOffset;
+            format.numFrames = (chunkSize < available ? chunkSize : available) / format.bytesPerFrame();
+            return true;
+        }
+
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+
+    error = "no data chunk";
+    return false;
+}
+
+void writeFloatWavHeader (std::uint8_t* dest, std::uint32_t numChannels, std::uint32_t sampleRate,
+                          std::uint64_t numFrames)
+{
+    const std::uint64_t dataSize = numFrames * numChannels * sizeof (float);
+    const std::uint64_t riffSize = floatWavHeaderSize - 8 + dataSize;
+    const bool rf64 = riffSize > rf64SizeMarker;
+
+    std::uint8_t* p = dest;
+    writeTag (p, rf64 ? "RF64" : "RIFF");
+    writeU32 (p, rf64 ? rf64SizeMarker : static_cast<std::uint32_t> (riffSize));
+    writeTag (p, "WAVE");
+
+    // Always reserve room for ds64 so the data offset does not depend on the file size; plain
+    // RIFF files carry it as a JUNK chunk that readers skip.
+    writeTag (p, rf64 ? "ds64" : "JUNK");
+    writeU32 (p, 28);
+    writeU64 (p, rf64 ? riffSize : 0);
+    writeU64 (p, rf64 ? dataSize : 0);
+    writeU64 (p, rf64 ? numFrames : 0);
+    writeU32 (p, 0);
+
+    writeTag (p, "fmt ");
+    writeU32 (p, 16);
+    writeU16 (p, formatFloat);
+    writeU16 (p, static_cast<std::uint16_t> (numChannels));
+    writeU32 (p, sampleRate);
+    writeU32 (p, static_cast<std::uint32_t> (sampleRate * numChannels * sizeof (float)));
+    writeU16 (p, static_cast<std::uint16_t> (numChannels * sizeof (float)));
+    writeU16 (p, 32);
+
+    writeTag (p, "data");
+    writeU32 (p, rf64 ? rf64SizeMarker : static_cast<std::uint32_t> (dataSize));
+}
+
+void deinterleaveToFloat (const std::uint8_t* src, const WavFormat& format, float* const* channels,
+                          std::size_t numFrames)
+{
+    const std::size_t stride = format.bytesPerFrame();
+    const std::size_t sampleBytes = format.bytesPerSample();
+    const std::size_t numChannels = format.numChannels;
+
+    switch (format.encoding)
+    {
+        case WavFormat::Encoding::pcm16:
+            deinterleave (src, stride, sampleBytes, channels, numChannels, numFrames, [] (const std::uint8_t* p) {
+                return static_cast<float> (static_cast<std::int16_t> (readU16 (p))) * (1.0f / 32768.0f);
+            });
+            break;
+
+        case WavFormat::Encoding::pcm24:
+            deinterleave (src, stride, sampleBytes, channels, numChannels, numFrames, [] (const std::uint8_t* p) {
+                // Place the 24 bits at the top of an int32 so the sign carries, then scale back.
+                const auto v = static_cast<std::int32_t> ((std::uint32_t { p[0] } << 8) | (std::uint32_t { p[1] } << 16)
+                                                          | (std::uint32_t { p[2] } << 24));
+                return static_cast<float> (v) * (1.0f / 2147483648.0f);
+            });
+            break;
+
+        case WavFormat::Encoding::pcm32:
+            deinterleave (src, stride, sampleBytes, channels, numChannels, numFrames, [] (const std::uint8_t* p) {
+                return static_cast<float> (static_cast<std::int32_t> (readU32 (p))) * (1.0f / 2147483648.0f);
+            });
+            break;
+
+        case WavFormat::Encoding::float32:
+            deinterleave (src, stride, sampleBytes, channels, numChannels, numFrames, [] (const std::uint8_t* p) {
+                float v;
+                std::memcpy (&v, p, sizeof v);
+                return v;
+            });
+            break;
+    }
+}
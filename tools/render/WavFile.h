@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Layout of the sample data in a RIFF/WAVE or RF64 file.
+struct WavFormat
+{
+    enum class Encoding
+    {
+        pcm16,
+        pcm24,
+        pcm32,
+        float32,
+    };
+
+    Encoding encoding = Encoding::float32;
+    std::uint32_t numChannels = 0;
+    std::uint32_t sampleRate = 0;
+    std::uint64_t numFrames = 0;
+
+    // Byte offset of the first sample within the file.
+    std::uint64_t dataOffset = 0;
+
+    std::uint32_t bytesPerSample() const;
+    std::uint64_t bytesPerFrame() const { return std::uint64_t { bytesPerSample() } * numChannels; }
+};
+
+// Parse the header of a mapped WAV/RF64 file. Accepts 16/24/32-bit integer PCM and 32-bit float,
+// plain or WAVE_FORMAT_EXTENSIBLE. Returns false and fills `error` for anything else.
+bool parseWavHeader (const std::uint8_t* file, std::uint64_t fileSize, WavFormat& format, std::string& error);
+
+// Size of the header written by writeFloatWavHeader; the sample data starts right after it.
+constexpr std::uint64_t floatWavHeaderSize = 80;
+
+// Write the header of a 32-bit float file with `numFrames` frames. The RF64 variant is chosen
+// automatically when the data does not fit the 4 GiB RIFF limit.
+void writeFloatWavHeader (std::uint8_t* dest, std::uint32_t numChannels, std::uint32_t sampleRate,
+                          std::uint64_t numFrames);
+
+// Decode `numFrames` interleaved frames into one float buffer per channel.
+void deinterleaveToFloat (const std::uint8_t* src, const WavFormat& format, float* const* channels,
+                          std::size_t numFrames);
@@ -0,0 +1,221 @@
+// automix-render: run a multichannel WAV/RF64 recording through the automix engine offline.
+//
+// The input and output files are memory-mapped and streamed one block at a time, so a
+// multi-hour, many-channel recording needs no more memory than a single block of audio.
+// No JUCE, GUI or audio device is involved.
+
+#include "MappedFile.h"
+#include "WavFile.h"
+
+#include <automix_dsp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace
+{
+    constexpr std::size_t defaultBlockSize = 1024;
+
+    struct Options
+    {
+        std::string inputPath;
+        std::string outputPath;
+        std::size_t blockSize = defaultBlockSize;
+        std::uint32_t workers = 0;
+        bool mixdown = false;
+    };
+
+    void printUsage (const char* program)
+    {
+        std::fprintf (stderr,
+                      "usage: %s [--block <samples>] [--workers <n>] [--mixdown] <input.wav> <output.wav>\n"
+                      "\n"
+                      "Applies automatic gain sharing to every channel of <input.wav> and writes the\n"
+                      "result as 32-bit float WAV (RF64 above 4 GiB).\n"
+                      "\n"
+                      "  --block <samples>  processing block size (default %zu)\n"
+                      "  --workers <n>      extra threads for large channel counts (default 0)\n"
+                      "  --mixdown          write the mono sum of all channels instead of every channel\n",
+                      program,
+                      defaultBlockSize);
+    }
+
+    bool parseOptions (int argc, char** argv, Options& options)
+    {
+        std::vector<std::string> paths;
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            if (arg == "--block" && i + 1 < argc)
+            {
+                const long value = std::strtol (argv[++i], nullptr, 10);
+                if (value <= 0)
+                    return false;
+                options.blockSize = static_cast<std::size_t> (value);
+            }
+            else if (arg == "--workers" && i + 1 < argc)
+            {
+                const long value = std::strtol (argv[++i], nullptr, 10);
+                if (value < 0)
+                    return false;
+                options.workers = static_cast<std::uint32_t> (value);
+            }
+            else if (arg == "--mixdown")
+            {
+                options.mixdown = true;
+            }
+            else if (arg.starts_with ("--"))
+            {
+                return false;
+            }
+            else
+            {
+                paths.push_back (arg);
+            }
+        }
+
+        if (paths.size() != 2)
+            return false;
+
+        options.inputPath = paths[0];
+        options.outputPath = paths[1];
+        return true;
+    }
+
+    // True when both paths name the same existing file, through links or different spellings.
+    bool isSameFile (const std::string& a, const std::string& b)
+    {
+        struct stat infoA {};
+        struct stat infoB {};
+        return ::stat (a.c_str(), &infoA) == 0 && ::stat (b.c_str(), &infoB) == 0
+               && infoA.st_dev == infoB.st_dev && infoA.st_ino == infoB.st_ino;
+    }
+
+    int fail (const std::string& message)
+    {
+        std::fprintf (stderr, "automix-render: %s\n", message.c_str());
+        return EXIT_FAILURE;
+    }
+} // namespace
+
+int main (int argc, char** argv)
+{
+    Options options;
+    if (! parseOptions (argc, argv, options))
+    {
+        printUsage (argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string error;
+    MappedFile input = MappedFile::openForReading (options.inputPath, error);
+    if (! input.isMapped())
+        return fail (error);
+    input.adviseSequential();
+
+    WavFormat format;
+    if (! parseWavHeader (input.data(), input.size(), format, error))
+        return fail (options.inputPath + ": " + error);
+
+    if (format.numChannels > AUTOMIX_MAX_CHANNELS)
+        return fail ("input has " + std::to_string (format.numChannels) + " channels, the engine supports "
+                     + std::to_string (AUTOMIX_MAX_CHANNELS));
+
+    const std::uint32_t outputChannels = options.mixdown ? 1 : format.numChannels;
+    const std::uint64_t outputSize =
+        floatWavHeaderSize + format.numFrames * outputChannels * sizeof (float);
+
+    // Creating the output truncates it, which would destroy an input that is still mapped.
+    if (isSameFile (options.inputPath, options.outputPath))
+        return fail (options.outputPath + ": output is the input file");
+
+    MappedFile output = MappedFile::createForWriting (options.outputPath, outputSize, error);
+    if (! output.isMapped())
+        return fail (error);
+    writeFloatWavHeader (output.data(), outputChannels, format.sampleRate, format.numFrames);
+
+    AutomixConfig config {};
+    config.num_channels = format.numChannels;
+    config.sample_rate = static_cast<float> (format.sampleRate);
+    config.max_block_size = static_cast<std::uint32_t> (options.blockSize);
+    config.num_workers = options.workers;
+    config.first_cpu = -1;
+    // Blocks follow each other back to back offline, so workers never need to sleep.
+    config.worker_spin_us = 100000;
+
+    AutomixEngine* engine = automix_create_ex (&config);
+    if (engine == nullptr)
+        return fail ("cannot create engine");
+
+    const std::size_t numChannels = format.numChannels;
+    const std::size_t blockSize = options.blockSize;
+    std::vector<float> scratch (numChannels * blockSize);
+    std::vector<float*> channels (numChannels);
+    for (std::size_t c = 0; c < numChannels; ++c)
+        channels[c] = scratch.data() + c * blockSize;
+    const std::vector<const float*> inputs (channels.begin(), channels.end());
+
+    // The header size keeps the sample data 4-byte aligned within the page-aligned mapping.
+    auto* out = reinterpret_cast<float*> (output.data() + floatWavHeaderSize);
+    const std::uint8_t* in = input.data() + format.dataOffset;
+
+    const auto start = std::chrono::steady_clock::now();
+    int lastPercent = -1;
+
+    for (std::uint64_t frame = 0; frame < format.numFrames; frame += blockSize)
+    {
+        const auto numFrames = static_cast<std::size_t> (std::min<std::uint64_t> (blockSize, format.numFrames - frame));
+
+        deinterleaveToFloat (in + frame * format.bytesPerFrame(), format, channels.data(), numFrames);
+
+        float* dest = out + frame * outputChannels;
+        if (options.mixdown)
+        {
+            // The engine sums the channels into the output while it applies their gains.
+            automix_process_out (engine,
+                                 inputs.data(),
+                                 channels.data(),
+                                 dest,
+                                 nullptr,
+                                 format.numChannels,
+                                 static_cast<std::uint32_t> (numFrames));
+        }
+        else
+        {
+            automix_process (engine,
+                             channels.data(),
+                             format.numChannels,
+                             static_cast<std::uint32_t> (numFrames));
+            for (std::size_t f = 0; f < numFrames; ++f)
+                for (std::size_t c = 0; c < numChannels; ++c)
+                    dest[f * numChannels + c] = channels[c][f];
+        }
+
+        const int percent = static_cast<int> ((frame + numFrames) * 100 / format.numFrames);
+        if (percent / 10 != lastPercent / 10)
+        {
+            std::fprintf (stderr, "\r%3d%%", percent);
+            lastPercent = percent;
+        }
+    }
+
+    automix_destroy (engine);
+
+    const double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+    const double audioSeconds = static_cast<double> (format.numFrames) / format.sampleRate;
+    std::fprintf (stderr,
+                  "\r%s: %u channels, %.1f s of audio in %.2f s (%.0fx real time)\n",
+                  options.outputPath.c_str(),
+                  format.numChannels,
+                  audioSeconds,
+                  seconds,
+                  seconds > 0.0 ? audioSeconds / seconds : 0.0);
+    return EXIT_SUCCESS;
+}